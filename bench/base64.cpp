@@ -0,0 +1,235 @@
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "utils/base64/base64.h"
+#include "bench.h"
+
+/// the byte-at-a-time encoder and decoder base64.cpp had before the SIMD blocks, kept as the reference
+namespace scalar
+{
+    static const std::string base64_chars =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz"
+        "0123456789+/";
+
+    static std::string encode(const std::string &string_to_encode)
+    {
+        std::string ret;
+        ret.reserve((string_to_encode.size() + 2) / 3 * 4);
+        size_t i = 0;
+        for(; i + 3 <= string_to_encode.size(); i += 3)
+        {
+            unsigned char a = string_to_encode[i], b = string_to_encode[i + 1], c = string_to_encode[i + 2];
+            ret += base64_chars[a >> 2];
+            ret += base64_chars[((a & 0x03) << 4) + (b >> 4)];
+            ret += base64_chars[((b & 0x0f) << 2) + (c >> 6)];
+            ret += base64_chars[c & 0x3f];
+        }
+        if(i < string_to_encode.size())
+        {
+            unsigned char a = string_to_encode[i], b = i + 1 < string_to_encode.size() ? string_to_encode[i + 1] : 0;
+            ret += base64_chars[a >> 2];
+            ret += base64_chars[((a & 0x03) << 4) + (b >> 4)];
+            ret += i + 1 < string_to_encode.size() ? base64_chars[(b & 0x0f) << 2] : '=';
+            ret += '=';
+        }
+        return ret;
+    }
+
+    struct Tables
+    {
+        unsigned char values[256] = {};
+        /// 1 for standard characters, 2 for the url-safe ones
+        unsigned char kinds[256] = {};
+
+        Tables()
+        {
+            for(size_t k = 0; k < base64_chars.size(); k++)
+            {
+                values[static_cast<unsigned char>(base64_chars[k])] = k;
+                kinds[static_cast<unsigned char>(base64_chars[k])] = 1;
+            }
+            values['-'] = values['+'];
+            kinds['-'] = 2;
+            values['_'] = values['/'];
+            kinds['_'] = 2;
+        }
+    };
+
+    static std::string decode(const std::string &encoded_string, bool accept_urlsafe)
+    {
+        static const Tables tables;
+        const unsigned char *values = tables.values, *kinds = tables.kinds;
+        std::string ret;
+        ret.reserve(encoded_string.size() / 4 * 3 + 3);
+        unsigned char group[4] = {};
+        size_t count = 0;
+        auto flush = [&]()
+        {
+            unsigned char v[4] = {};
+            for(size_t j = 0; j < count; j++)
+                v[j] = values[group[j]];
+            const char bytes[3] = {
+                static_cast<char>((v[0] << 2) + ((v[1] & 0x30) >> 4)),
+                static_cast<char>(((v[1] & 0xf) << 4) + ((v[2] & 0x3c) >> 2)),
+                static_cast<char>(((v[2] & 0x3) << 6) + v[3])
+            };
+            ret.append(bytes, count == 4 ? 3 : count - 1);
+            count = 0;
+        };
+        for(unsigned char uchar : encoded_string)
+        {
+            if(uchar == '=')
+                break;
+            if(!(accept_urlsafe ? kinds[uchar] : kinds[uchar] == 1))
+            {
+                ret += static_cast<char>(uchar);
+                count = 0;
+                continue;
+            }
+            group[count++] = uchar;
+            if(count == 4)
+                flush();
+        }
+        if(count)
+            flush();
+        return ret;
+    }
+}
+
+static const char *simdLevel()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return "avx2";
+    if(__builtin_cpu_supports("sse4.1"))
+        return "sse4.1";
+#endif
+    return "scalar";
+}
+
+/// random text that is mostly base64, with url-safe characters, stray bytes, line breaks and padding mixed in
+static std::string randomEncoded(std::mt19937 &rng)
+{
+    static const std::string alphabet = scalar::base64_chars + "-_";
+    static const std::string noise = "\r\n =.:\x80\xff";
+    std::string result;
+    size_t length = rng() % 300;
+    for(size_t i = 0; i < length; i++)
+    {
+        unsigned int pick = rng() % 100;
+        if(pick < 90)
+            result += alphabet[rng() % (pick < 85 ? 64 : 66)];
+        else
+            result += noise[rng() % noise.size()];
+    }
+    return result;
+}
+
+static size_t checkEncode()
+{
+    std::mt19937 rng(20261017);
+    size_t mismatches = 0;
+    for(int i = 0; i < 100000; i++)
+    {
+        std::string plain(rng() % 300, '\0');
+        for(char &c : plain)
+            c = static_cast<char>(rng());
+        std::string expected = scalar::encode(plain);
+        /// streaming output has to match whatever the piece boundaries are
+        std::string pieces;
+        Base64StreamEncoder encoder;
+        for(size_t pos = 0; pos < plain.size();)
+        {
+            size_t size = std::min<size_t>(rng() % 70 + 1, plain.size() - pos);
+            encoder.feed(plain.data() + pos, size, pieces);
+            pos += size;
+        }
+        encoder.finish(pieces);
+        if((base64Encode(plain) != expected || pieces != expected) && mismatches++ < 5)
+            printf("encode mismatch on %zu bytes\n", plain.size());
+    }
+    return mismatches;
+}
+
+static size_t checkDecode()
+{
+    std::mt19937 rng(20261016);
+    size_t mismatches = 0;
+    for(int i = 0; i < 100000; i++)
+    {
+        std::string encoded = i % 2 ? randomEncoded(rng) : base64Encode(randomEncoded(rng));
+        bool urlsafe = rng() % 2;
+        std::string expected = scalar::decode(encoded, urlsafe);
+        /// the same input fed in random pieces has to give the same output
+        std::string pieces;
+        Base64StreamDecoder decoder(urlsafe);
+        for(size_t pos = 0; pos < encoded.size();)
+        {
+            size_t size = std::min<size_t>(rng() % 70 + 1, encoded.size() - pos);
+            decoder.feed(encoded.data() + pos, size, pieces);
+            pos += size;
+        }
+        decoder.finish(pieces);
+        if((base64Decode(encoded, urlsafe) != expected || pieces != expected) && mismatches++ < 5)
+            printf("decode mismatch on '%s'%s\n", encoded.c_str(), urlsafe ? " (url-safe)" : "");
+    }
+    return mismatches;
+}
+
+int main(int argc, char *argv[])
+{
+    if(checkMode(argc, argv))
+    {
+        size_t mismatches = checkEncode() + checkDecode();
+        printf("base64 checks: %zu mismatches\n", mismatches);
+        return mismatches ? 1 : 0;
+    }
+
+    /// a subscription body of 5000 links and the kind of payload a single vmess:// link carries
+    std::mt19937 rng(1);
+    std::string links;
+    for(int i = 0; i < 5000; i++)
+    {
+        links += "vmess://";
+        for(int j = 0; j < 200; j++)
+            links += scalar::base64_chars[rng() % 64];
+        links += "\n";
+    }
+    std::string body = base64Encode(links), link = urlSafeBase64Encode(links.substr(0, 300));
+    printf("simd level: %s\n", simdLevel());
+
+    size_t checksum = 0;
+    double body_simd = bestOf(7, [&](){ checksum += base64Decode(body, true).size(); });
+    double body_scalar = bestOf(7, [&](){ checksum += scalar::decode(body, true).size(); });
+    printf("decode %zu byte body: %.2f ms, scalar %.2f ms\n", body.size(), body_simd, body_scalar);
+    double link_simd = bestOf(7, [&](){ for(int i = 0; i < 100000; i++) checksum += urlSafeBase64Decode(link).size(); });
+    double link_scalar = bestOf(7, [&](){ for(int i = 0; i < 100000; i++) checksum += scalar::decode(link, true).size(); });
+    printf("decode %zu byte link x100000: %.2f ms, scalar %.2f ms\n", link.size(), link_simd, link_scalar);
+
+    double encode_simd = bestOf(7, [&](){ checksum += base64Encode(links).size(); });
+    double encode_scalar = bestOf(7, [&](){ checksum += scalar::encode(links).size(); });
+    printf("encode %zu byte link list: %.2f ms, scalar %.2f ms\n", links.size(), encode_simd, encode_scalar);
+    /// how proxyToSingle used to work, joining every link before encoding, against encoding each link as it is produced
+    double joined = bestOf(7, [&]()
+    {
+        std::string all;
+        for(size_t pos = 0; pos < links.size(); pos += 209)
+            all.append(links, pos, 209);
+        checksum += base64Encode(all).size();
+    });
+    double streamed = bestOf(7, [&]()
+    {
+        std::string out;
+        Base64StreamEncoder encoder;
+        for(size_t pos = 0; pos < links.size(); pos += 209)
+            encoder.feed(links.data() + pos, 209, out);
+        encoder.finish(out);
+        checksum += out.size();
+    });
+    printf("encode 5000 links: joined then encoded %.2f ms, streamed %.2f ms\n", joined, streamed);
+    printf("checksum %zu\n", checksum);
+    return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef BENCH_H_INCLUDED
+#define BENCH_H_INCLUDED
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+/// best wall time of several rounds in milliseconds, the first round doubles as warm-up
+template <typename Func>
+double bestOf(int rounds, Func &&func)
+{
+    double best = 1e30;
+    for(int i = 0; i < rounds; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+/// path of a file shipped in base/, for benchmarks that run on the bundled snippets
+inline std::string basePath(const std::string &name)
+{
+    return std::string(BENCH_BASE_DIR) + "/" + name;
+}
+
+/// every benchmark binary runs its differential checks instead of timing when started with --check
+inline bool checkMode(int argc, char *argv[])
+{
+    return argc > 1 && strcmp(argv[1], "--check") == 0;
+}
+
+#endif // BENCH_H_INCLUDED
@@ -0,0 +1,282 @@
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "parser/clash_yaml.h"
+#include "utils/yamlcpp_extra.h"
+#include "bench.h"
+
+/// a provider file like the ones airports serve, one proxy per entry in flow or block style
+static std::string makeProvider(size_t count, bool flow)
+{
+    const char *places[] = {"香港", "日本", "新加坡", "美国", "台湾"};
+    std::string doc = "port: 7890\nproxies:\n";
+    for(size_t i = 0; i < count; i++)
+    {
+        std::string name = std::string(places[i % 5]) + " " + std::to_string(i), server = "node" + std::to_string(i) + ".example.com";
+        std::string port = std::to_string(10000 + i % 50000), uuid = "b831381d-6324-4d53-ad4f-8cda48b3" + std::to_string(1000 + i % 9000);
+        if(flow)
+            doc += "  - {name: \"" + name + "\", server: " + server + ", port: " + port + ", type: vmess, uuid: " + uuid + ", alterId: 0, cipher: auto, tls: true, udp: true, network: ws, ws-opts: {path: /ray, headers: {Host: " + server + "}}}\n";
+        else
+            doc += "  - name: '" + name + "'\n    server: " + server + "\n    port: " + port + "\n    type: vmess\n    uuid: " + uuid + "\n    alterId: 0\n    cipher: auto\n    tls: true\n    udp: true\n    network: ws\n    ws-opts:\n      path: /ray\n      headers:\n        Host: " + server + "\n";
+    }
+    return doc + "rules:\n  - MATCH,DIRECT\n";
+}
+
+/// random proxies sections mixing block and flow collections, quoting styles, comments and stray indicator characters
+class DocumentGenerator
+{
+public:
+    explicit DocumentGenerator(uint32_t seed) : m_rng(seed) {}
+
+    std::string generate()
+    {
+        std::string doc;
+        size_t indent = m_rng() % 2 ? 2 : 0;
+        for(size_t n = m_rng() % 4; n > 0; n--)
+            blockItem(doc, indent, 0);
+        /// a stray character anywhere except the first column, which would end the section instead
+        if(!doc.empty() && m_rng() % 3 == 0)
+        {
+            const char noise[] = "\t:#-{}[],'\"&*!|>?% ";
+            size_t pos = m_rng() % doc.size();
+            if(pos && doc[pos - 1] != '\n')
+                doc.insert(pos, 1, noise[m_rng() % (sizeof(noise) - 1)]);
+        }
+        return doc;
+    }
+
+private:
+    std::string scalar()
+    {
+        const char *atoms[] = {"a", "server", "1", "-1", "0.5", "true", "no", "null", "~", "", "香港 01", "a b", "x:y", "a #b", "/ray",
+                               "'q'", "'it''s'", "''", "\"dq\"", "\"\"", "\"a\\nb\"", "\"a: b\"", "'[x]'", "-", "a,b", "a]", "{", "&x y", "*x", "!tag x"};
+        return atoms[m_rng() % (sizeof(atoms) / sizeof(atoms[0]))];
+    }
+
+    std::string key()
+    {
+        const char *keys[] = {"name", "server", "port", "type", "ws-opts", "headers", "Host", "'quoted key'", "\"dq key\"", "a b", "null", "1"};
+        return keys[m_rng() % (sizeof(keys) / sizeof(keys[0]))];
+    }
+
+    std::string flow(int depth)
+    {
+        unsigned int pick = m_rng() % 4;
+        if(depth > 2 || pick < 2)
+            return scalar();
+        bool is_map = pick == 2;
+        std::string result = is_map ? "{" : "[";
+        for(size_t n = m_rng() % 4; n > 0; n--)
+        {
+            result += is_map ? key() + ": " + flow(depth + 1) : flow(depth + 1);
+            if(n > 1)
+                result += m_rng() % 4 ? ", " : ",";
+        }
+        return result + (is_map ? "}" : "]");
+    }
+
+    std::string comment()
+    {
+        return m_rng() % 8 == 0 ? " # note" : "";
+    }
+
+    void blockItem(std::string &doc, size_t indent, int depth)
+    {
+        doc += std::string(indent, ' ') + "-";
+        if(depth > 2 || m_rng() % 3 == 0)
+        {
+            doc += " " + flow(depth) + comment() + "\n";
+            return;
+        }
+        /// the first key sits on the dash line, the others line up under it
+        blockMapping(doc, indent + 2, depth, true);
+    }
+
+    void blockMapping(std::string &doc, size_t indent, int depth, bool after_dash)
+    {
+        for(size_t n = m_rng() % 4 + 1; n > 0; n--)
+        {
+            doc += after_dash ? " " : std::string(indent, ' ');
+            after_dash = false;
+            doc += key() + ":";
+            unsigned int pick = m_rng() % 6;
+            if(depth > 2 || pick < 3)
+                doc += " " + flow(depth) + comment() + "\n";
+            else if(pick == 3)
+            {
+                doc += comment() + "\n";
+                blockMapping(doc, indent + 2, depth + 1, false);
+            }
+            else
+            {
+                /// sequences under a key may or may not be indented
+                doc += "\n";
+                size_t child_indent = pick == 4 ? indent : indent + 2;
+                for(size_t items = m_rng() % 3 + 1; items > 0; items--)
+                    blockItem(doc, child_indent, depth + 1);
+            }
+            if(m_rng() % 10 == 0)
+                doc += "\n";
+        }
+    }
+
+    std::mt19937 m_rng;
+};
+
+/// both trees written out the same way, scalars with their length so that quoting cannot hide a difference
+static void dumpScalar(std::string_view value, std::string &out)
+{
+    out += std::to_string(value.size()) + ":";
+    out += value;
+}
+
+static void dumpEntry(const ClashYamlReader &reader, uint32_t index, std::string &out)
+{
+    const ClashYamlEntry &entry = reader.entry(index);
+    switch(entry.kind)
+    {
+    case ClashYamlEntry::Null:
+        out += "~";
+        break;
+    case ClashYamlEntry::Scalar:
+        dumpScalar(entry.scalar, out);
+        break;
+    case ClashYamlEntry::Map:
+        out += "{";
+        for(uint32_t child = entry.first_child; child; child = reader.entry(child).next_sibling)
+        {
+            dumpScalar(reader.entry(child).key, out);
+            dumpEntry(reader, child, out);
+        }
+        out += "}";
+        break;
+    case ClashYamlEntry::Sequence:
+        out += "[";
+        for(uint32_t child = entry.first_child; child; child = reader.entry(child).next_sibling)
+            dumpEntry(reader, child, out);
+        out += "]";
+        break;
+    }
+}
+
+static void dumpNode(const YAML::Node &node, std::string &out)
+{
+    switch(node.Type())
+    {
+    case YAML::NodeType::Null:
+        out += "~";
+        break;
+    case YAML::NodeType::Scalar:
+        dumpScalar(node.Scalar(), out);
+        break;
+    case YAML::NodeType::Map:
+        out += "{";
+        for(const auto &pair : node)
+        {
+            if(!pair.first.IsScalar())
+                out += "?";
+            else
+                dumpScalar(pair.first.Scalar(), out);
+            dumpNode(pair.second, out);
+        }
+        out += "}";
+        break;
+    case YAML::NodeType::Sequence:
+        out += "[";
+        for(const auto &item : node)
+            dumpNode(item, out);
+        out += "]";
+        break;
+    default:
+        out += "!";
+        break;
+    }
+}
+
+/// whenever the reader takes a whole section, yaml-cpp has to load it into the same tree
+static size_t checkReader(size_t &accepted)
+{
+    DocumentGenerator generator(20261021);
+    size_t mismatches = 0;
+    for(int i = 0; i < 300000; i++)
+    {
+        std::string section = generator.generate();
+        std::string expected, result;
+        try
+        {
+            ClashYamlReader reader(section);
+            ClashYamlNode node;
+            while(reader.next(node))
+                dumpEntry(reader, 0, result);
+        }
+        catch(ClashYamlUnsupported&)
+        {
+            continue;
+        }
+        accepted++;
+        try
+        {
+            YAML::Node proxies = YAML::Load("proxies:\n" + section)["proxies"];
+            if(proxies.IsSequence())
+                for(const auto &item : proxies)
+                    dumpNode(item, expected);
+            else if(!proxies.IsNull())
+                expected = "not a sequence";
+        }
+        catch(YAML::Exception &e)
+        {
+            expected = e.what();
+        }
+        if(result != expected && mismatches++ < 5)
+            printf("reader mismatch on:\n%s\nreader  %s\nyaml-cpp %s\n", section.c_str(), result.c_str(), expected.c_str());
+    }
+    return mismatches;
+}
+
+/// the lookups explodeClash() does first on every proxy
+template <typename Node>
+static size_t readFields(const Node &proxy)
+{
+    size_t size = 0;
+    for(const char *field : {"name", "type", "server", "port", "uuid", "cipher"})
+        size += safe_as<std::string>(proxy[field]).size();
+    return size + safe_as<std::string>(proxy["ws-opts"]["headers"]["Host"]).size();
+}
+
+int main(int argc, char *argv[])
+{
+    if(checkMode(argc, argv))
+    {
+        size_t accepted = 0, mismatches = checkReader(accepted);
+        printf("clash yaml checks: %zu documents taken by the reader, %zu mismatches\n", accepted, mismatches);
+        return mismatches ? 1 : 0;
+    }
+
+    size_t checksum = 0;
+    for(size_t count : {5000, 20000})
+    {
+        for(bool flow : {true, false})
+        {
+            std::string doc = makeProvider(count, flow);
+            std::string_view section = std::string_view(doc).substr(doc.find("proxies:\n") + 9);
+            double yaml_ms = bestOf(count > 5000 ? 3 : 5, [&]()
+            {
+                YAML::Node proxies = YAML::Load(doc)["proxies"];
+                for(size_t i = 0; i < proxies.size(); i++)
+                    checksum += readFields(proxies[i]);
+            });
+            double reader_ms = bestOf(7, [&]()
+            {
+                ClashYamlReader reader(section);
+                ClashYamlNode proxy;
+                while(reader.next(proxy))
+                    checksum += readFields(proxy);
+            });
+            printf("%5zu proxies, %-5s %.2f MB: yaml-cpp %.1f ms, ClashYamlReader %.1f ms\n", count, flow ? "flow" : "block", doc.size() / 1048576.0, yaml_ms, reader_ms);
+        }
+    }
+    printf("checksum %zu\n", checksum);
+    return 0;
+}
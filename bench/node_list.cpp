@@ -0,0 +1,183 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "parser/config/proxy.h"
+#include "bench.h"
+
+/// every allocation goes through here, with its size kept in front of the block so that frees can be counted too
+struct HeapStats
+{
+    size_t allocs = 0, bytes = 0, live = 0, peak = 0;
+};
+
+static HeapStats heap;
+
+static void *countedAlloc(size_t size)
+{
+    void *block = malloc(size + alignof(std::max_align_t));
+    if(!block)
+        throw std::bad_alloc();
+    *static_cast<size_t*>(block) = size;
+    heap.allocs++;
+    heap.bytes += size;
+    heap.live += size;
+    heap.peak = std::max(heap.peak, heap.live);
+    return static_cast<char*>(block) + alignof(std::max_align_t);
+}
+
+static void countedFree(void *ptr)
+{
+    if(!ptr)
+        return;
+    void *block = static_cast<char*>(ptr) - alignof(std::max_align_t);
+    heap.live -= *static_cast<size_t*>(block);
+    free(block);
+}
+
+void *operator new(size_t size) { return countedAlloc(size); }
+void *operator new[](size_t size) { return countedAlloc(size); }
+void operator delete(void *ptr) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, size_t) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { countedFree(ptr); }
+
+/// a VMess node as the link parsers fill it, most strings are past the small string buffer
+static std::vector<Proxy> makeNodes(size_t count, const std::string &tag)
+{
+    const char *places[] = {"香港", "日本", "新加坡", "美国", "台湾"};
+    std::vector<Proxy> nodes(count);
+    for(size_t i = 0; i < count; i++)
+    {
+        Proxy &node = nodes[i];
+        node.Type = ProxyType::VMess;
+        node.Id = i;
+        node.Group = V2RAY_DEFAULT_GROUP;
+        node.Remark = std::string(places[i % 5]) + " IPLC " + tag + " " + std::to_string(i);
+        node.Hostname = "node" + std::to_string(i) + ".provider.example.com";
+        node.Port = 10000 + i % 50000;
+        node.UserId = "b831381d-6324-4d53-ad4f-8cda48b3" + std::to_string(1000 + i % 9000);
+        node.EncryptMethod = "auto";
+        node.TransferProtocol = "ws";
+        node.FakeType = "none";
+        node.Host = "cdn.provider.example.com";
+        node.Path = "/ray?ed=2048&id=" + std::to_string(i);
+        node.TLSSecure = true;
+        node.ServerName = node.Hostname;
+    }
+    return nodes;
+}
+
+/// how copyNodes() and the insert/prepend merge moved nodes before, one element at a time through a back_inserter
+static void backInsertNodes(std::vector<Proxy> &source, std::vector<Proxy> &dest)
+{
+    std::move(source.begin(), source.end(), std::back_inserter(dest));
+}
+
+/// the body of copyNodes(), which lives in nodemanip.cpp together with everything the subscription fetching needs
+static void swapInsertNodes(std::vector<Proxy> &source, std::vector<Proxy> &dest)
+{
+    if(dest.empty())
+        dest.swap(source);
+    else
+        dest.insert(dest.end(), std::make_move_iterator(source.begin()), std::make_move_iterator(source.end()));
+    source.clear();
+}
+
+static std::string remarksOf(const std::vector<Proxy> &nodes)
+{
+    std::string result;
+    for(const Proxy &x : nodes)
+        result += x.Remark + "\n";
+    return result;
+}
+
+/// both merge forms have to leave the same nodes in the same order, whatever the list sizes
+static size_t checkMerges()
+{
+    std::mt19937 rng(20261022);
+    size_t mismatches = 0;
+    for(int i = 0; i < 2000; i++)
+    {
+        std::vector<Proxy> source = makeNodes(rng() % 20, "s"), dest = makeNodes(rng() % 3 ? rng() % 20 : 0, "d");
+        std::vector<Proxy> source_copy = source, dest_copy = dest;
+        backInsertNodes(source_copy, dest_copy);
+        swapInsertNodes(source, dest);
+        if((remarksOf(dest) != remarksOf(dest_copy) || !source.empty()) && mismatches++ < 5)
+            printf("merge mismatch on %zu + %zu nodes\n", dest.size() - source_copy.size(), source_copy.size());
+    }
+    return mismatches;
+}
+
+/// allocations, bytes and heap peak of one run, then the best time of several runs with fresh input prepared outside the timing
+template <typename Prepare, typename Func>
+static void measure(const char *name, Prepare &&prepare, Func &&func)
+{
+    auto input = prepare();
+    HeapStats before = heap;
+    heap.peak = heap.live;
+    func(input);
+    size_t allocs = heap.allocs - before.allocs, bytes = heap.bytes - before.bytes, peak = heap.peak - before.live;
+    heap.peak = std::max(heap.peak, before.peak);
+
+    double best = 1e30;
+    for(int i = 0; i < 7; i++)
+    {
+        auto fresh = prepare();
+        best = std::min(best, bestOf(1, [&](){ func(fresh); }));
+    }
+    printf("  %-32s %6zu allocs, %6.1f MB, peak +%5.1f MB, %6.2f ms\n", name, allocs, bytes / 1048576.0, peak / 1048576.0, best);
+}
+
+int main(int argc, char *argv[])
+{
+    if(checkMode(argc, argv))
+    {
+        size_t mismatches = checkMerges();
+        printf("node list checks: %zu mismatches\n", mismatches);
+        return mismatches ? 1 : 0;
+    }
+
+    const size_t count = 5000;
+    printf("sizeof(Proxy) %zu\n", sizeof(Proxy));
+    size_t allocs = heap.allocs, bytes = heap.bytes;
+    std::vector<Proxy> nodes = makeNodes(count, "a");
+    printf("filling %zu nodes: %zu allocs, %.1f MB\n", count, heap.allocs - allocs, (heap.bytes - bytes) / 1048576.0);
+    size_t checksum = 0;
+
+    /// what a generator keeps of the nodes it wrote, for matching the proxy groups against afterwards
+    printf("generator node list\n");
+    auto none = [](){ return 0; };
+    measure("copies (std::vector<Proxy>)", none, [&](int)
+    {
+        std::vector<Proxy> nodelist;
+        for(const Proxy &x : nodes)
+            nodelist.emplace_back(x);
+        checksum += nodelist.size();
+    });
+    measure("pointers (ProxyRefs)", none, [&](int)
+    {
+        std::vector<const Proxy*> nodelist;
+        for(const Proxy &x : nodes)
+            nodelist.emplace_back(&x);
+        checksum += nodelist.size();
+    });
+
+    /// the first subscription of a request lands in an empty list, prepending moves all nodes behind the few insert nodes
+    using Lists = std::pair<std::vector<Proxy>, std::vector<Proxy>>;
+    auto into_empty = [&](){ return Lists(nodes, {}); };
+    auto into_insert = [&](){ return Lists(nodes, makeNodes(20, "insert")); };
+    printf("merge %zu nodes into an empty list\n", count);
+    measure("back_inserter", into_empty, [&](Lists &lists){ backInsertNodes(lists.first, lists.second); checksum += lists.second.size(); });
+    measure("copyNodes", into_empty, [&](Lists &lists){ swapInsertNodes(lists.first, lists.second); checksum += lists.second.size(); });
+    printf("prepend 20 insert nodes to %zu nodes\n", count);
+    measure("back_inserter", into_insert, [&](Lists &lists){ backInsertNodes(lists.first, lists.second); checksum += lists.second.size(); });
+    measure("copyNodes", into_insert, [&](Lists &lists){ swapInsertNodes(lists.first, lists.second); checksum += lists.second.size(); });
+    printf("checksum %zu\n", checksum);
+    return 0;
+}
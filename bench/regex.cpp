@@ -0,0 +1,173 @@
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <jpcre2.hpp>
+
+#include "utils/regexp.h"
+#include "bench.h"
+
+struct Rule
+{
+    std::string match, replace;
+};
+
+/// rules in "match<delimiter>replace" form, the bundled rename snippet ships with every rule commented out
+static std::vector<Rule> loadRules(const std::string &path, char delimiter, bool uncomment)
+{
+    std::vector<Rule> rules;
+    std::ifstream in(path);
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if(uncomment && !line.empty() && line[0] == ';')
+            line.erase(0, 1);
+        while(!line.empty() && line.back() == ' ')
+            line.pop_back();
+        std::string::size_type pos = line.rfind(delimiter);
+        if(line.empty() || line[0] == ';' || pos == std::string::npos || pos == 0)
+            continue;
+        rules.push_back({line.substr(0, pos), line.substr(pos + 1)});
+    }
+    return rules;
+}
+
+static std::vector<std::string> makeRemarks(size_t count)
+{
+    const char *places[] = {"中国上海", "香港", "日本东京", "美国洛杉矶", "新加坡", "台湾台北", "韩国首尔", "英国伦敦", "德国法兰克福", "俄罗斯莫斯科", "Hong Kong", "Japan", "Singapore", "US"};
+    const char *lines[] = {"IPLC", "BGP", "CN2 GIA", "HKT", "家宽", "Netflix"};
+    std::vector<std::string> remarks;
+    for(size_t i = 0; i < count; i++)
+        remarks.push_back(std::string(places[i % 14]) + " " + lines[i % 6] + " " + std::to_string(i % 50 + 1) + (i % 4 ? " [1.5x]" : " 2倍率"));
+    return remarks;
+}
+
+/// the answer PCRE2 gives on its own, with the options regFind and regMatch compile with
+static bool pcre2Find(const std::string &src, const std::string &pattern, bool full)
+{
+    int error = 0;
+    PCRE2_SIZE offset = 0;
+    uint32_t options = PCRE2_UTF | PCRE2_MULTILINE | (full ? PCRE2_ANCHORED | PCRE2_ENDANCHORED : PCRE2_ALT_BSUX);
+    pcre2_code_8 *code = pcre2_compile_8(reinterpret_cast<PCRE2_SPTR8>(pattern.data()), pattern.size(), options, &error, &offset, nullptr);
+    if(code == nullptr)
+        return false;
+    pcre2_match_data_8 *match_data = pcre2_match_data_create_from_pattern_8(code, nullptr);
+    bool result = pcre2_match_8(code, reinterpret_cast<PCRE2_SPTR8>(src.data()), src.size(), 0, 0, match_data, nullptr) >= 0;
+    pcre2_match_data_free_8(match_data);
+    pcre2_code_free_8(code);
+    return result;
+}
+
+/// literal fast path against PCRE2 on random literals, anchors, (?i) and subjects with characters that fold to ASCII
+static size_t checkLiterals()
+{
+    std::mt19937 rng(20261016);
+    const char *atoms[] = {"a", "B", "k", "S", "x", " ", "\xE2\x84\xAA", "\xC5\xBF", "\n", "港"};
+    auto generate = [&](size_t max_atoms, size_t atom_count)
+    {
+        std::string result;
+        for(size_t i = rng() % max_atoms; i > 0; i--)
+            result += atoms[rng() % atom_count];
+        return result;
+    };
+    size_t mismatches = 0;
+    for(int i = 0; i < 200000; i++)
+    {
+        std::string pattern = std::string(rng() % 2 ? "(?i)" : "") + (rng() % 3 ? "" : "^") + generate(4, 6) + (rng() % 3 ? "" : "$");
+        std::string subject = generate(8, 10);
+        bool full = rng() % 4 == 0;
+        bool result = full ? regMatch(subject, pattern) : regFind(subject, pattern);
+        if(result != pcre2Find(subject, pattern, full) && mismatches++ < 5)
+            printf("literal mismatch: '%s' on '%s'%s\n", pattern.c_str(), subject.c_str(), full ? " (full match)" : "");
+    }
+    return mismatches;
+}
+
+/// combined emoji lookup against trying the rules one by one
+static size_t checkCombined(const std::vector<Rule> &emojis, const std::vector<std::string> &remarks)
+{
+    std::vector<std::string> patterns;
+    for(const Rule &x : emojis)
+        if(regCanCombine(x.match))
+            patterns.push_back(x.match);
+    std::string combined = regCombine(patterns);
+    size_t mismatches = 0;
+    for(const std::string &remark : remarks)
+    {
+        int expected = -1;
+        for(size_t i = 0; i < patterns.size(); i++)
+        {
+            if(regFind(remark, patterns[i]))
+            {
+                expected = static_cast<int>(i);
+                break;
+            }
+        }
+        if(regFindAny(remark, combined) != expected && mismatches++ < 5)
+            printf("combined mismatch on '%s'\n", remark.c_str());
+    }
+    return mismatches;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<Rule> renames = loadRules(basePath("snippets/rename_node.txt"), '@', true);
+    std::vector<Rule> emojis = loadRules(basePath("snippets/emoji.txt"), ',', false);
+    std::vector<std::string> remarks = makeRemarks(5000);
+
+    if(checkMode(argc, argv))
+    {
+        size_t mismatches = checkLiterals() + checkCombined(emojis, remarks);
+        printf("regex checks: %zu mismatches\n", mismatches);
+        return mismatches ? 1 : 0;
+    }
+
+    size_t checksum = 0;
+    double rename_ms = bestOf(7, [&]()
+    {
+        for(std::string remark : remarks)
+        {
+            for(const Rule &x : renames)
+                remark = regReplace(remark, x.match, x.replace);
+            checksum += remark.size();
+        }
+    });
+    double emoji_ms = bestOf(7, [&]()
+    {
+        for(const std::string &remark : remarks)
+        {
+            for(size_t i = 0; i < emojis.size(); i++)
+            {
+                if(regFind(remark, emojis[i].match))
+                {
+                    checksum += i;
+                    break;
+                }
+            }
+        }
+    });
+    printf("%zu rename rules, %zu emoji rules, %zu remarks: rename %.1f ms, emoji %.1f ms\n", renames.size(), emojis.size(), remarks.size(), rename_ms, emoji_ms);
+
+    /// the same literal through the fast path and, wrapped in a group, through PCRE2
+    const char *shapes[][2] = {{"IPLC", "(?:IPLC)"}, {"(?i)iplc", "(?i)(?:iplc)"}, {"^香港", "^(?:香港)"}, {"(?i)1\\.5X\\]$", "(?i)(?:1\\.5X\\])$"}};
+    for(auto &shape : shapes)
+    {
+        double times[2];
+        for(int i = 0; i < 2; i++)
+        {
+            times[i] = bestOf(7, [&]()
+            {
+                for(int round = 0; round < 20; round++)
+                    for(const std::string &remark : remarks)
+                        checksum += regFind(remark, shape[i]);
+            });
+        }
+        printf("%-12s fast path %6.2f ms, PCRE2 %6.2f ms per 100000 lookups\n", shape[0], times[0], times[1]);
+    }
+    printf("checksum %zu\n", checksum);
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "utils/string.h"
+#include "bench.h"
+
+/// every ruleset under base/rules, one string per file
+static std::vector<std::string> loadCorpus()
+{
+    std::vector<std::string> files;
+    for(const auto &entry : std::filesystem::recursive_directory_iterator(basePath("rules")))
+    {
+        if(!entry.is_regular_file())
+            continue;
+        std::ifstream in(entry.path(), std::ios::binary);
+        std::stringstream content;
+        content << in.rdbuf();
+        files.push_back(content.str());
+    }
+    return files;
+}
+
+static std::vector<std::string> withEndings(const std::vector<std::string> &files, const std::string &ending)
+{
+    std::vector<std::string> result;
+    for(const std::string &x : files)
+    {
+        std::string converted = replaceAllDistinct(x, "\r\n", "\n");
+        result.push_back(ending == "\n" ? converted : replaceAllDistinct(converted, "\n", ending));
+    }
+    return result;
+}
+
+/// how the converters read lines before LineTokenizer: a stringstream, getline and a '\r' strip per line
+static void getlineLines(const std::string &text, std::vector<std::string> &lines)
+{
+    std::stringstream ss(text);
+    std::string line;
+    char delimiter = text.find('\n') != std::string::npos ? '\n' : '\r';
+    while(std::getline(ss, line, delimiter))
+    {
+        if(delimiter == '\n' && !line.empty() && line.back() == '\r')
+            line.pop_back();
+        lines.push_back(line);
+    }
+}
+
+static size_t checkTokenizers()
+{
+    std::mt19937 rng(20261018);
+    const char *atoms[] = {"a", "b", ",", ",", "\n", "\r", "\r\n", " ", "规则"};
+    size_t mismatches = 0;
+    for(int i = 0; i < 100000; i++)
+    {
+        std::string text;
+        for(size_t n = rng() % 40; n > 0; n--)
+            text += atoms[rng() % 9];
+        std::vector<std::string> expected;
+        getlineLines(text, expected);
+        std::vector<std::string> lines;
+        LineTokenizer tokenizer(text);
+        std::string_view line;
+        while(tokenizer.next(line))
+            lines.emplace_back(line);
+        if(lines != expected && mismatches++ < 5)
+            printf("line mismatch on %zu bytes\n", text.size());
+
+        std::vector<std::string> fields;
+        StringTokenizer field_tokenizer(text, ',');
+        std::string_view field;
+        while(field_tokenizer.next(field))
+            fields.emplace_back(field);
+        if(fields != split(text, ",") && mismatches++ < 5)
+            printf("field mismatch on %zu bytes\n", text.size());
+    }
+    return mismatches;
+}
+
+int main(int argc, char *argv[])
+{
+    if(checkMode(argc, argv))
+    {
+        size_t mismatches = checkTokenizers();
+        printf("tokenizer checks: %zu mismatches\n", mismatches);
+        return mismatches ? 1 : 0;
+    }
+
+    std::vector<std::string> corpus = loadCorpus();
+    size_t bytes = 0, checksum = 0;
+    for(const std::string &x : corpus)
+        bytes += x.size();
+    printf("%zu rulesets, %zu bytes\n", corpus.size(), bytes);
+
+    const char *endings[][2] = {{"\n", "LF"}, {"\r\n", "CRLF"}, {"\r", "CR"}};
+    for(auto &ending : endings)
+    {
+        std::vector<std::string> files = withEndings(corpus, ending[0]);
+        double old_ms = bestOf(7, [&]()
+        {
+            for(const std::string &x : files)
+            {
+                std::stringstream ss(x);
+                std::string line;
+                char delimiter = x.find('\n') != std::string::npos ? '\n' : '\r';
+                while(std::getline(ss, line, delimiter))
+                {
+                    if(!line.empty() && line.back() == '\r')
+                        line.pop_back();
+                    checksum += line.size();
+                }
+            }
+        });
+        double new_ms = bestOf(7, [&]()
+        {
+            for(const std::string &x : files)
+            {
+                LineTokenizer lines(x);
+                std::string_view line;
+                while(lines.next(line))
+                    checksum += line.size();
+            }
+        });
+        printf("lines, %-4s getline %.2f ms, LineTokenizer %.2f ms\n", ending[1], old_ms, new_ms);
+    }
+
+    /// rule lines such as "DOMAIN-SUFFIX,google.com,Proxy" split into their fields
+    double split_ms = bestOf(7, [&]()
+    {
+        for(const std::string &x : corpus)
+        {
+            LineTokenizer lines(x);
+            std::string_view line;
+            while(lines.next(line))
+                checksum += split(std::string(line), ",").size();
+        }
+    });
+    double field_ms = bestOf(7, [&]()
+    {
+        for(const std::string &x : corpus)
+        {
+            LineTokenizer lines(x);
+            std::string_view line, field;
+            while(lines.next(line))
+            {
+                StringTokenizer fields(line, ',');
+                while(fields.next(field))
+                    checksum++;
+            }
+        }
+    });
+    printf("fields, split() %.2f ms, StringTokenizer %.2f ms\n", split_ms, field_ms);
+    printf("checksum %zu\n", checksum);
+    return 0;
+}
@@ -2,7 +2,12 @@
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
+#include "handler/multithread.h"
 #include "handler/settings.h"
 #include "handler/webget.h"
 #include "parser/config/proxy.h"
@@ -12,6 +17,7 @@
 #include "utils/file_extra.h"
 #include "utils/logger.h"
 #include "utils/map_extra.h"
+#include "utils/md5/md5.h"
 #include "utils/network.h"
 #include "utils/regexp.h"
 #include "utils/urlencode.h"
@@ -29,7 +35,87 @@ int explodeConf(const std::string &filepath, std::vector<Proxy> &nodes)
 
 void copyNodes(std::vector<Proxy> &source, std::vector<Proxy> &dest)
 {
-    std::move(source.begin(), source.end(), std::back_inserter(dest));
+    /// a Proxy is well over 1 KB, take over the whole buffer when possible and grow at most once otherwise
+    if(dest.empty())
+        dest.swap(source);
+    else
+        dest.insert(dest.end(), std::make_move_iterator(source.begin()), std::make_move_iterator(source.end()));
+    source.clear();
+}
+
+/// nodes of a subscription body after parsing and filtering, shared by all requests that receive the same content
+struct ParsedSubscription
+{
+    std::vector<Proxy> nodes;
+    bool info_computed = false, info_found = false;
+    std::string info;
+};
+
+struct ParsedCacheEntry
+{
+    std::shared_ptr<const ParsedSubscription> value;
+    size_t last_access = 0;
+};
+
+static std::mutex on_parsed;
+static std::unordered_map<std::string, ParsedCacheEntry> parsed_cache;
+static size_t parsed_tick = 0;
+
+/// everything the cached result depends on, the custom group and group id are applied after the lookup
+static std::string parsedCacheKey(const std::string &content, const string_array &exclude_remarks, const string_array &include_remarks, const RegexMatchConfigs &stream_rules, const RegexMatchConfigs &time_rules)
+{
+    char result[MD5_STRING_SIZE];
+    md5::md5_t md5;
+    auto feed = [&](const std::string &value)
+    {
+        std::string size = std::to_string(value.size()) + ":";
+        md5.process(size.data(), size.size());
+        md5.process(value.data(), value.size());
+    };
+    feed(content);
+    for(const string_array *list : {&exclude_remarks, &include_remarks})
+    {
+        feed(std::to_string(list->size()));
+        for(const std::string &x : *list)
+            feed(x);
+    }
+    for(const RegexMatchConfigs *list : {&stream_rules, &time_rules})
+    {
+        feed(std::to_string(list->size()));
+        for(const RegexMatchConfig &x : *list)
+        {
+            feed(x.Match);
+            feed(x.Replace);
+            feed(x.Script);
+        }
+    }
+    md5.finish();
+    md5.get_string(result);
+    return result;
+}
+
+static std::shared_ptr<const ParsedSubscription> parsedCacheFind(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(on_parsed);
+    auto iter = parsed_cache.find(key);
+    if(iter == parsed_cache.end())
+        return nullptr;
+    iter->second.last_access = ++parsed_tick;
+    return iter->second.value;
+}
+
+static void parsedCachePut(const std::string &key, std::shared_ptr<const ParsedSubscription> value)
+{
+    std::lock_guard<std::mutex> lock(on_parsed);
+    parsed_cache[key] = {std::move(value), ++parsed_tick};
+    while(parsed_cache.size() > static_cast<size_t>(global.cacheParsedEntries))
+    {
+        auto oldest = std::min_element(parsed_cache.begin(), parsed_cache.end(), [](const auto &a, const auto &b)
+        {
+            return a.second.last_access < b.second.last_access;
+        });
+        parsed_cache.erase(oldest);
+    }
 }
 
 int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID, parse_settings &parse_set)
@@ -139,10 +225,15 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID, parse_
     switch(linkType)
     {
     case ConfType::SUB:
+    {
         writeLog(LOG_TYPE_INFO, "Downloading subscription data...");
         if(startsWith(link, "surge:///install-config")) //surge config link
             link = urlDecode(getUrlArg(link, "url"));
-        strSub = webGet(link, proxy, global.cacheSubscription, &extra_headers, request_headers);
+        /// link-per-line subscriptions are parsed while they are still downloading
+        StreamingSubParser stream_parser;
+        FetchStream stream;
+        stream.on_content = [&](const char *data, size_t size){ stream_parser.feed(data, size); };
+        strSub = webGet(link, proxy, global.cacheSubscription, &extra_headers, request_headers, &stream);
         /*
         if(strSub.size() == 0)
         {
@@ -159,22 +250,56 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID, parse_
         */
         if(!strSub.empty())
         {
-            writeLog(LOG_TYPE_INFO, "Parsing subscription data...");
-            if(explodeConfContent(strSub, nodes) == 0)
+            bool use_cache = global.cacheParsedEntries > 0, is_ssd = startsWith(strSub, "ssd://");
+            std::string cache_key, header_sub_info;
+            bool header_info = !is_ssd && getSubInfoFromHeader(extra_headers, header_sub_info);
+            std::shared_ptr<const ParsedSubscription> parsed;
+            if(use_cache)
             {
-                writeLog(LOG_TYPE_ERROR, "Invalid subscription: '" + link + "'!");
-                return -1;
+                cache_key = parsedCacheKey(strSub, exclude_remarks, include_remarks, stream_rules, time_rules);
+                parsed = parsedCacheFind(cache_key);
+                /// the entry was stored while the header carried the info, it lacks the one taken from nodes
+                if(parsed && !header_info && !parsed->info_computed)
+                    parsed.reset();
             }
-            if(startsWith(strSub, "ssd://"))
+            if(parsed)
             {
-                getSubInfoFromSSD(strSub, subInfo);
+                writeLog(LOG_TYPE_INFO, "Subscription data unchanged, reusing parsed nodes.");
+                /// later processing renames and reorders nodes in place, every request works on its own copy
+                nodes = parsed->nodes;
             }
             else
             {
-                if(!getSubInfoFromHeader(extra_headers, subInfo))
-                    getSubInfoFromNodes(nodes, stream_rules, time_rules, subInfo);
+                writeLog(LOG_TYPE_INFO, "Parsing subscription data...");
+                bool streamed = stream.delivered && stream_parser.finish(strSub, nodes);
+                if(streamed ? nodes.empty() : explodeConfContent(strSub, nodes) == 0)
+                {
+                    writeLog(LOG_TYPE_ERROR, "Invalid subscription: '" + link + "'!");
+                    return -1;
+                }
+                auto result = std::make_shared<ParsedSubscription>();
+                if(is_ssd)
+                {
+                    result->info_found = getSubInfoFromSSD(strSub, result->info);
+                    result->info_computed = true;
+                }
+                else if(!header_info)
+                {
+                    result->info_found = getSubInfoFromNodes(nodes, stream_rules, time_rules, result->info);
+                    result->info_computed = true;
+                }
+                filterNodes(nodes, exclude_remarks, include_remarks, groupID);
+                if(use_cache)
+                {
+                    result->nodes = nodes;
+                    parsedCachePut(cache_key, result);
+                }
+                parsed = std::move(result);
             }
-            filterNodes(nodes, exclude_remarks, include_remarks, groupID);
+            if(header_info)
+                subInfo = header_sub_info;
+            else if(parsed->info_found)
+                subInfo = parsed->info;
             for(Proxy &x : nodes)
             {
                 x.GroupId = groupID;
@@ -189,6 +314,7 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID, parse_
             return -1;
         }
         break;
+    }
     case ConfType::Local:
         if(!authorized)
             return -1;
@@ -230,156 +356,148 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID, parse_
     return 0;
 }
 
-bool chkIgnore(const Proxy &node, string_array &exclude_remarks, string_array &include_remarks)
+void addNodesConcurrently(std::vector<NodeLinkTask> &tasks, parse_settings &parse_set, int max_concurrent)
 {
-    bool excluded = false, included = false;
-    //std::string remarks = UTF8ToACP(node.remarks);
-    //std::string remarks = node.remarks;
-    //writeLog(LOG_TYPE_INFO, "Comparing exclude remarks...");
-    excluded = std::any_of(exclude_remarks.cbegin(), exclude_remarks.cend(), [&node](const auto &x)
+    /// script links share the request script context, keep them on this thread
+    auto is_local_task = [&](const NodeLinkTask &task)
     {
-        std::string real_rule;
-        if(applyMatcher(x, real_rule, node))
-        {
-            if(real_rule.empty()) return true;
-            return regFind(node.Remark, real_rule);
-        }
-        else
-            return false;
-    });
-    if(include_remarks.size() != 0)
+        return parse_set.authorized && startsWith(replaceAllDistinct(task.link, "\"", ""), "script:");
+    };
+    auto run_task = [&](NodeLinkTask &task, bool shared_context)
     {
-        //writeLog(LOG_TYPE_INFO, "Comparing include remarks...");
-        included = std::any_of(include_remarks.cbegin(), include_remarks.cend(), [&node](const auto &x)
-        {
-            std::string real_rule;
-            if(applyMatcher(x, real_rule, node))
-            {
-                if(real_rule.empty()) return true;
-                return regFind(node.Remark, real_rule);
-            }
-            else
-                return false;
-        });
+        parse_settings task_set = parse_set;
+        task_set.sub_info = &task.sub_info;
+#ifndef NO_JS_RUNTIME
+        if(!shared_context)
+            task_set.js_runtime = nullptr, task_set.js_context = nullptr;
+#endif // NO_JS_RUNTIME
+        task.result = addNodes(task.link, task.nodes, task.groupID, task_set);
+    };
+
+    std::vector<NodeLinkTask*> remote_tasks;
+    for(NodeLinkTask &x : tasks)
+    {
+        if(!is_local_task(x))
+            remote_tasks.push_back(&x);
     }
-    else
+    size_t worker_count = std::min<size_t>(remote_tasks.size(), std::max(max_concurrent, 1));
+    if(worker_count <= 1)
     {
-        included = true;
+        for(NodeLinkTask &x : tasks)
+            run_task(x, true);
+        return;
     }
 
-    return excluded || !included;
-}
-
-void filterNodes(std::vector<Proxy> &nodes, string_array &exclude_remarks, string_array &include_remarks, int groupID)
-{
-    int node_index = 0;
-    std::vector<Proxy>::iterator iter = nodes.begin();
-    while(iter != nodes.end())
+    /// every task writes only to its own slot, results are merged by the caller in list order
+    fetchParallelFor(FetchPriority::Subscription, remote_tasks.size(), worker_count - 1, [&](size_t index)
     {
-        if(chkIgnore(*iter, exclude_remarks, include_remarks))
-        {
-            writeLog(LOG_TYPE_INFO, "Node  " + iter->Group + " - " + iter->Remark + "  has been ignored and will not be added.");
-            nodes.erase(iter);
-        }
-        else
+        run_task(*remote_tasks[index], false);
+    }, [&]()
+    {
+        for(NodeLinkTask &x : tasks)
         {
-            writeLog(LOG_TYPE_INFO, "Node  " + iter->Group + " - " + iter->Remark + "  has been added.");
-            iter->Id = node_index;
-            iter->GroupId = groupID;
-            ++node_index;
-            ++iter;
+            if(is_local_task(x))
+                run_task(x, true);
         }
-    }
-    /*
-    std::vector<std::unique_ptr<pcre2_code, decltype(&pcre2_code_free)>> exclude_patterns, include_patterns;
-    std::vector<std::unique_ptr<pcre2_match_data, decltype(&pcre2_match_data_free)>> exclude_match_data, include_match_data;
-    unsigned int i = 0;
-    PCRE2_SIZE erroroffset;
-    int errornumber, rc;
-
-    for(i = 0; i < exclude_remarks.size(); i++)
+    });
+}
+
+/// include and exclude remarks compiled once for a whole filter pass
+struct NodeFilter
+{
+    std::vector<NodeMatcherPtr> exclude, include;
+};
+
+static NodeFilter compileFilter(const string_array &exclude_remarks, const string_array &include_remarks)
+{
+    NodeFilter filter;
+    for(const std::string &x : exclude_remarks)
+        filter.exclude.emplace_back(compileMatcher(x));
+    for(const std::string &x : include_remarks)
+        filter.include.emplace_back(compileMatcher(x));
+    return filter;
+}
+
+static bool filterIgnores(const NodeFilter &filter, const Proxy &node)
+{
+    auto matches = [&node](const NodeMatcherPtr &x){ return x->matchRemark(node); };
+    if(std::any_of(filter.exclude.cbegin(), filter.exclude.cend(), matches))
+        return true;
+    return !filter.include.empty() && std::none_of(filter.include.cbegin(), filter.include.cend(), matches);
+}
+
+bool chkIgnore(const Proxy &node, string_array &exclude_remarks, string_array &include_remarks)
+{
+    return filterIgnores(compileFilter(exclude_remarks, include_remarks), node);
+}
+
+/// lists with more nodes than this are checked on several threads
+static constexpr size_t parallel_filter_nodes = 4096;
+static constexpr size_t filter_chunk_nodes = 512;
+
+/// check the nodes in chunks on the shared executor
+static void checkNodesParallel(const NodeFilter &filter, const std::vector<Proxy> &nodes, std::vector<char> &ignored)
+{
+    size_t chunks = (nodes.size() + filter_chunk_nodes - 1) / filter_chunk_nodes;
+    size_t helpers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    fetchParallelFor(FetchPriority::Subscription, chunks, helpers, [&](size_t chunk)
     {
-        std::unique_ptr<pcre2_code, decltype(&pcre2_code_free)> pattern(pcre2_compile(reinterpret_cast<const unsigned char*>(exclude_remarks[i].c_str()), exclude_remarks[i].size(), PCRE2_UTF | PCRE2_MULTILINE | PCRE2_ALT_BSUX, &errornumber, &erroroffset, NULL), &pcre2_code_free);
-        if(!pattern)
-            return;
-        exclude_patterns.emplace_back(std::move(pattern));
-        pcre2_jit_compile(exclude_patterns[i].get(), 0);
-        std::unique_ptr<pcre2_match_data, decltype(&pcre2_match_data_free)> match_data(pcre2_match_data_create_from_pattern(exclude_patterns[i].get(), NULL), &pcre2_match_data_free);
-        exclude_match_data.emplace_back(std::move(match_data));
-    }
-    for(i = 0; i < include_remarks.size(); i++)
+        size_t end = std::min(nodes.size(), (chunk + 1) * filter_chunk_nodes);
+        for(size_t i = chunk * filter_chunk_nodes; i < end; i++)
+            ignored[i] = filterIgnores(filter, nodes[i]);
+    });
+}
+
+void filterNodes(std::vector<Proxy> &nodes, string_array &exclude_remarks, string_array &include_remarks, int groupID)
+{
+    NodeFilter filter = compileFilter(exclude_remarks, include_remarks);
+    /// one byte per node, so that threads can write neighbouring results
+    std::vector<char> ignored(nodes.size(), 0);
+    bool has_rules = !filter.exclude.empty() || !filter.include.empty();
+    if(has_rules && nodes.size() > parallel_filter_nodes)
+        checkNodesParallel(filter, nodes, ignored);
+    else if(has_rules)
     {
-        std::unique_ptr<pcre2_code, decltype(&pcre2_code_free)> pattern(pcre2_compile(reinterpret_cast<const unsigned char*>(include_remarks[i].c_str()), include_remarks[i].size(), PCRE2_UTF | PCRE2_MULTILINE | PCRE2_ALT_BSUX, &errornumber, &erroroffset, NULL), &pcre2_code_free);
-        if(!pattern)
-            return;
-        include_patterns.emplace_back(std::move(pattern));
-        pcre2_jit_compile(include_patterns[i].get(), 0);
-        std::unique_ptr<pcre2_match_data, decltype(&pcre2_match_data_free)> match_data(pcre2_match_data_create_from_pattern(include_patterns[i].get(), NULL), &pcre2_match_data_free);
-        include_match_data.emplace_back(std::move(match_data));
+        for(size_t i = 0; i < nodes.size(); i++)
+            ignored[i] = filterIgnores(filter, nodes[i]);
     }
-    writeLog(LOG_TYPE_INFO, "Filter started.");
-    while(iter != nodes.end())
+
+    bool verbose = global.logLevel >= LOG_LEVEL_VERBOSE;
+    size_t kept = 0;
+    for(size_t i = 0; i < nodes.size(); i++)
     {
-        bool excluded = false, included = false;
-        for(i = 0; i < exclude_patterns.size(); i++)
-        {
-            rc = pcre2_match(exclude_patterns[i].get(), reinterpret_cast<const unsigned char*>(iter->remarks.c_str()), iter->remarks.size(), 0, 0, exclude_match_data[i].get(), NULL);
-            if (rc < 0)
-            {
-                switch(rc)
-                {
-                case PCRE2_ERROR_NOMATCH:
-                    break;
-                default:
-                    return;
-                }
-            }
-            else
-                excluded = true;
-        }
-        if(include_patterns.size() > 0)
-            for(i = 0; i < include_patterns.size(); i++)
-            {
-                rc = pcre2_match(include_patterns[i].get(), reinterpret_cast<const unsigned char*>(iter->remarks.c_str()), iter->remarks.size(), 0, 0, include_match_data[i].get(), NULL);
-                if (rc < 0)
-                {
-                    switch(rc)
-                    {
-                    case PCRE2_ERROR_NOMATCH:
-                        break;
-                    default:
-                        return;
-                    }
-                }
-                else
-                    included = true;
-            }
-        else
-            included = true;
-        if(excluded || !included)
-        {
-            writeLog(LOG_TYPE_INFO, "Node  " + iter->group + " - " + iter->remarks + "  has been ignored and will not be added.");
-            nodes.erase(iter);
-        }
-        else
-        {
-            writeLog(LOG_TYPE_INFO, "Node  " + iter->group + " - " + iter->remarks + "  has been added.");
-            iter->id = node_index;
-            iter->groupID = groupID;
-            ++node_index;
-            ++iter;
-        }
+        Proxy &node = nodes[i];
+        if(verbose)
+            writeLog(LOG_TYPE_INFO, "Node  " + node.Group + " - " + node.Remark + (ignored[i] ? "  has been ignored and will not be added." : "  has been added."));
+        if(ignored[i])
+            continue;
+        node.Id = kept;
+        node.GroupId = groupID;
+        /// stable compaction, kept nodes move down over the ignored ones in their original order
+        if(kept != i)
+            nodes[kept] = std::move(node);
+        kept++;
     }
-    */
+    nodes.resize(kept);
     writeLog(LOG_TYPE_INFO, "Filter done.");
 }
 
-void nodeRename(Proxy &node, const RegexMatchConfigs &rename_array, extra_settings &ext)
+std::vector<NodeMatcherPtr> compileMatchers(const RegexMatchConfigs &rules)
+{
+    std::vector<NodeMatcherPtr> matchers;
+    matchers.reserve(rules.size());
+    for(const RegexMatchConfig &x : rules)
+        matchers.emplace_back(compileMatcher(x.Match));
+    return matchers;
+}
+
+void nodeRename(Proxy &node, const RegexMatchConfigs &rename_array, const std::vector<NodeMatcherPtr> &rename_matchers, extra_settings &ext)
 {
-    std::string &remark = node.Remark, original_remark = node.Remark, returned_remark, real_rule;
+    std::string &remark = node.Remark, original_remark = node.Remark, returned_remark;
 
-    for(const RegexMatchConfig &x : rename_array)
+    for(size_t i = 0; i < rename_array.size(); i++)
     {
+        const RegexMatchConfig &x = rename_array[i];
         if(!x.Script.empty() && ext.authorized)
         {
             script_safe_runner(ext.js_runtime, ext.js_context, [&](qjs::Context &ctx)
@@ -402,8 +520,9 @@ void nodeRename(Proxy &node, const RegexMatchConfigs &rename_array, extra_settin
             }, global.scriptCleanContext);
             continue;
         }
-        if(applyMatcher(x.Match, real_rule, node) && real_rule.size())
-            remark = regReplace(remark, real_rule, x.Replace);
+        const NodeMatcher &matcher = *rename_matchers[i];
+        if(!matcher.real_rule.empty() && matcher.matchNode(node))
+            remark = regReplace(remark, matcher.real_rule, x.Replace);
     }
     if(remark.empty())
         remark = original_remark;
@@ -426,56 +545,123 @@ std::string removeEmoji(const std::string &orig_remark)
     return remark;
 }
 
-std::string addEmoji(const Proxy &node, const RegexMatchConfigs &emoji_array, extra_settings &ext)
+struct EmojiMatchStep
 {
-    std::string real_rule, ret;
+    std::string combined; /// combined pattern for a run of plain regex rules, empty for a single rule
+    std::vector<size_t> rules;
+    NodeMatcherPtr matcher; /// compiled matcher of a single rule
+};
 
-    for(const RegexMatchConfig &x : emoji_array)
+using EmojiMatcher = std::vector<EmojiMatchStep>;
+
+EmojiMatcher buildEmojiMatcher(const RegexMatchConfigs &emoji_array)
+{
+    EmojiMatcher matcher;
+    string_array run_patterns;
+    std::vector<size_t> run_rules;
+    auto flush_run = [&]()
     {
-        if(!x.Script.empty() && ext.authorized)
+        if(run_rules.empty())
+            return;
+        if(run_rules.size() == 1)
+            matcher.push_back({"", run_rules, compileMatcher(run_patterns[0])});
+        else
+            matcher.push_back({regCombine(run_patterns), run_rules, nullptr});
+        run_patterns.clear();
+        run_rules.clear();
+    };
+    for(size_t i = 0; i < emoji_array.size(); i++)
+    {
+        const RegexMatchConfig &x = emoji_array[i];
+        if(x.Script.empty() && (x.Replace.empty() || x.Match.empty()))
+            continue;
+        /// scripts and !! matchers need the whole node, keep them as standalone steps in their original position
+        if(!x.Script.empty() || startsWith(x.Match, "!!") || !regCanCombine(x.Match))
         {
-            std::string result;
-            script_safe_runner(ext.js_runtime, ext.js_context, [&](qjs::Context &ctx)
+            flush_run();
+            matcher.push_back({"", {i}, compileMatcher(x.Match)});
+            continue;
+        }
+        run_patterns.push_back(x.Match);
+        run_rules.push_back(i);
+    }
+    flush_run();
+    return matcher;
+}
+
+std::string addEmoji(const Proxy &node, const RegexMatchConfig &x, const NodeMatcher &rule_matcher, extra_settings &ext, bool &matched)
+{
+    std::string ret;
+    matched = false;
+    if(!x.Script.empty() && ext.authorized)
+    {
+        std::string result;
+        script_safe_runner(ext.js_runtime, ext.js_context, [&](qjs::Context &ctx)
+        {
+            std::string script = x.Script;
+            if(startsWith(script, "path:"))
+                script = fileGet(script.substr(5), true);
+            try
             {
-                std::string script = x.Script;
-                if(startsWith(script, "path:"))
-                    script = fileGet(script.substr(5), true);
-                try
-                {
-                    ctx.eval(script);
-                    auto getEmoji = (std::function<std::string(const Proxy&)>) ctx.eval("getEmoji");
-                    ret = getEmoji(node);
-                    if(!ret.empty())
-                        result = ret + " " + node.Remark;
-                }
-                catch (qjs::exception)
-                {
-                    script_print_stack(ctx);
-                }
-            }, global.scriptCleanContext);
-            if(!result.empty())
+                ctx.eval(script);
+                auto getEmoji = (std::function<std::string(const Proxy&)>) ctx.eval("getEmoji");
+                ret = getEmoji(node);
+                if(!ret.empty())
+                    result = ret + " " + node.Remark;
+            }
+            catch (qjs::exception)
+            {
+                script_print_stack(ctx);
+            }
+        }, global.scriptCleanContext);
+        matched = !result.empty();
+        return result;
+    }
+    if(x.Replace.empty())
+        return "";
+    if(!rule_matcher.real_rule.empty() && rule_matcher.matchRemark(node))
+    {
+        matched = true;
+        return x.Replace + " " + node.Remark;
+    }
+    return "";
+}
+
+std::string addEmoji(const Proxy &node, const RegexMatchConfigs &emoji_array, const EmojiMatcher &matcher, extra_settings &ext)
+{
+    bool matched = false;
+    for(const EmojiMatchStep &step : matcher)
+    {
+        if(step.combined.empty())
+        {
+            std::string result = addEmoji(node, emoji_array[step.rules[0]], *step.matcher, ext, matched);
+            if(matched)
                 return result;
             continue;
         }
-        if(x.Replace.empty())
-            continue;
-        if(applyMatcher(x.Match, real_rule, node) && real_rule.size() && regFind(node.Remark, real_rule))
-            return x.Replace + " " + node.Remark;
+        int index = regFindAny(node.Remark, step.combined);
+        if(index >= 0 && index < static_cast<int>(step.rules.size()))
+            return emoji_array[step.rules[index]].Replace + " " + node.Remark;
     }
     return node.Remark;
 }
 
 void preprocessNodes(std::vector<Proxy> &nodes, extra_settings &ext)
 {
-    std::for_each(nodes.begin(), nodes.end(), [&ext](Proxy &x)
+    std::vector<NodeMatcherPtr> rename_matchers = compileMatchers(ext.rename_array);
+    EmojiMatcher emoji_matcher;
+    if(ext.add_emoji)
+        emoji_matcher = buildEmojiMatcher(ext.emoji_array);
+
+    std::for_each(nodes.begin(), nodes.end(), [&ext, &rename_matchers, &emoji_matcher](Proxy &x)
     {
         if(ext.remove_emoji)
             x.Remark = trim(removeEmoji(x.Remark));
 
-        nodeRename(x, ext.rename_array, ext);
+        nodeRename(x, ext.rename_array, rename_matchers, ext);
 
         if(ext.add_emoji)
-            x.Remark = addEmoji(x, ext.emoji_array, ext);
+            x.Remark = addEmoji(x, ext.emoji_array, emoji_matcher, ext);
     });
 
     if(ext.sort_flag)
@@ -12,6 +12,7 @@
 #include "config/regmatch.h"
 #include "parser/config/proxy.h"
 #include "utils/map_extra.h"
+#include "utils/regexp.h"
 #include "utils/string.h"
 
 struct parse_settings
@@ -30,9 +31,73 @@ struct parse_settings
 #endif // NO_JS_RUNTIME
 };
 
+/// nodes pointing into a list that stays unchanged while they are in use, like the nodes written by a generator
+using ProxyRefs = std::vector<const Proxy*>;
+
+/// compiled form of a node matching rule such as "!!GROUP=xxx!!remark_regex"
+struct NodeMatcher
+{
+    enum class Target
+    {
+        Remark,
+        Group,
+        GroupId,
+        Type,
+        Port,
+        Server
+    };
+
+    enum class RangeOp
+    {
+        Equal,
+        Between,
+        NotEqual,
+        NotBetween,
+        AtMost,
+        AtLeast
+    };
+
+    struct RangeTerm
+    {
+        RangeOp op = RangeOp::Equal;
+        int first = 0;
+        int second = 0;
+    };
+
+    Target target = Target::Remark;
+    int direction = 1;
+    std::vector<RangeTerm> ranges;
+    uint32_t type_mask = 0;
+    RegexHandle pattern;
+    std::string real_rule;
+    RegexHandle remark;
+
+    bool matchNode(const Proxy &node) const;
+    bool matchRemark(const Proxy &node) const
+    {
+        return matchNode(node) && (real_rule.empty() || regFind(node.Remark, remark));
+    }
+    std::vector<bool> matchRemarks(const ProxyRefs &nodes) const;
+};
+
+using NodeMatcherPtr = std::shared_ptr<const NodeMatcher>;
+
+/// one subscription link to be loaded by addNodesConcurrently
+struct NodeLinkTask
+{
+    std::string link;
+    int groupID = 0;
+    int result = 0;
+    std::vector<Proxy> nodes;
+    std::string sub_info;
+};
+
+void copyNodes(std::vector<Proxy> &source, std::vector<Proxy> &dest);
 int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID, parse_settings &parse_set);
+void addNodesConcurrently(std::vector<NodeLinkTask> &tasks, parse_settings &parse_set, int max_concurrent);
 void filterNodes(std::vector<Proxy> &nodes, string_array &exclude_remarks, string_array &include_remarks, int groupID);
 bool applyMatcher(const std::string &rule, std::string &real_rule, const Proxy &node);
+NodeMatcherPtr compileMatcher(const std::string &rule);
 void preprocessNodes(std::vector<Proxy> &nodes, extra_settings &ext);
 
 #endif // NODEMANIP_H_INCLUDED
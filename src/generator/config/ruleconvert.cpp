@@ -86,7 +86,7 @@ std::string convertRuleset(const std::string &content, int type)
     /// Source: QuanX type,pattern[,group]
     ///         Clash payload:\n  - 'ipcidr/domain/classic(Surge-like)'
 
-    std::string output, strLine;
+    std::string output;
 
 #ifdef _WIN32
     SQLHENV henv;
@@ -122,59 +122,55 @@ std::string convertRuleset(const std::string &content, int type)
         output = regReplace(regReplace(content, "payload:\\r?\\n", "", true), R"(\s?^\s*-\s+('|"?)(.*)\1$)", "\n$2", true);
         if(type == RULESET_CLASH_CLASSICAL) /// classical type
             return output;
-        std::stringstream ss;
-        ss << output;
-        char delimiter = getLineBreak(output);
-        output.clear();
-        string_size pos, lineSize;
-        while(getline(ss, strLine, delimiter))
+        /// the lines point into the text being converted, so build the result separately
+        std::string result;
+        result.reserve(output.size());
+        LineTokenizer lines(output);
+        std::string_view line;
+        string_size pos;
+        while(lines.next(line))
         {
-            strLine = trim(strLine);
-            lineSize = strLine.size();
-            if(lineSize && strLine[lineSize - 1] == '\r') //remove line break
-                strLine.erase(--lineSize);
+            line = trimOf(line, ' ');
 
-            if(strFind(strLine, "//"))
-            {
-                strLine.erase(strLine.find("//"));
-                strLine = trimWhitespace(strLine);
-            }
+            pos = line.find("//");
+            if(pos != std::string_view::npos)
+                line = trimWhitespace(line.substr(0, pos));
 
-            if(!strLine.empty() && (strLine[0] != ';' && strLine[0] != '#' && !(lineSize >= 2 && strLine[0] == '/' && strLine[1] == '/')))
+            if(!line.empty() && (line[0] != ';' && line[0] != '#'))
             {
-                pos = strLine.find('/');
-                if(pos != std::string::npos) /// ipcidr
+                pos = line.find('/');
+                if(pos != std::string_view::npos) /// ipcidr
                 {
-                    if(isIPv4(strLine.substr(0, pos)))
-                        output += "IP-CIDR,";
+                    if(isIPv4(std::string(line.substr(0, pos))))
+                        result += "IP-CIDR,";
                     else
-                        output += "IP-CIDR6,";
+                        result += "IP-CIDR6,";
                 }
                 else
                 {
-                    if(strLine[0] == '.' || (lineSize >= 2 && strLine[0] == '+' && strLine[1] == '.')) /// suffix
+                    if(line[0] == '.' || (line.size() >= 2 && line[0] == '+' && line[1] == '.')) /// suffix
                     {
                         bool keyword_flag = false;
-                        while(endsWith(strLine, ".*"))
+                        while(line.ends_with(".*"))
                         {
                             keyword_flag = true;
-                            strLine.erase(strLine.size() - 2);
+                            line.remove_suffix(2);
                         }
-                        output += "DOMAIN-";
+                        result += "DOMAIN-";
                         if(keyword_flag)
-                            output += "KEYWORD,";
+                            result += "KEYWORD,";
                         else
-                            output += "SUFFIX,";
-                        strLine.erase(0, 2 - (strLine[0] == '.'));
+                            result += "SUFFIX,";
+                        line.remove_prefix(std::min<string_size>(!line.empty() && line[0] == '.' ? 1 : 2, line.size()));
                     }
                     else
-                        output += "DOMAIN,";
+                        result += "DOMAIN,";
                 }
             }
-            output += strLine;
-            output += '\n';
+            result += line;
+            result += '\n';
         }
-        return output;
+        return result;
     }
     else /// QuanX
     {
@@ -184,7 +180,7 @@ std::string convertRuleset(const std::string &content, int type)
     }
 }
 
-static std::string transformRuleToCommon(string_view_array &temp, const std::string &input, const std::string &group, bool no_resolve_only = false)
+static std::string transformRuleToCommon(string_view_array &temp, std::string_view input, const std::string &group, bool no_resolve_only = false)
 {
     temp.clear();
     std::string strLine;
@@ -224,7 +220,6 @@ void rulesetToClash(YAML::Node &base_rule, std::vector<RulesetContent> &ruleset_
 {
     string_array allRules;
     std::string rule_group, retrieved_rules, strLine;
-    std::stringstream strStrm;
     const std::string field_name = new_field_name ? "rules" : "Rule";
     YAML::Node rules;
     size_t total_rules = 0;
@@ -255,27 +250,22 @@ void rulesetToClash(YAML::Node &base_rule, std::vector<RulesetContent> &ruleset_
             continue;
         }
         retrieved_rules = convertRuleset(retrieved_rules, x.rule_type);
-        char delimiter = getLineBreak(retrieved_rules);
-
-        strStrm.clear();
-        strStrm<<retrieved_rules;
-        std::string::size_type lineSize;
-        while(getline(strStrm, strLine, delimiter))
+        LineTokenizer lines(retrieved_rules);
+        std::string_view line;
+        string_size pos;
+        while(lines.next(line))
         {
             if(global.maxAllowedRules && total_rules > global.maxAllowedRules)
                 break;
-            strLine = trimWhitespace(strLine, true, true); //remove whitespaces
-            lineSize = strLine.size();
-            if(!lineSize || strLine[0] == ';' || strLine[0] == '#' || (lineSize >= 2 && strLine[0] == '/' && strLine[1] == '/')) //empty lines and comments are ignored
+            line = trimWhitespace(line, true, true); //remove whitespaces
+            if(line.empty() || line[0] == ';' || line[0] == '#' || line.starts_with("//")) //empty lines and comments are ignored
                 continue;
-            if(std::none_of(ClashRuleTypes.begin(), ClashRuleTypes.end(), [strLine](const std::string& type){return startsWith(strLine, type);}))
+            if(std::none_of(ClashRuleTypes.begin(), ClashRuleTypes.end(), [line](const std::string& type){return line.starts_with(type);}))
                 continue;
-            if(strFind(strLine, "//"))
-            {
-                strLine.erase(strLine.find("//"));
-                strLine = trimWhitespace(strLine);
-            }
-            strLine = transformRuleToCommon(temp, strLine, rule_group);
+            pos = line.find("//");
+            if(pos != std::string_view::npos)
+                line = trimWhitespace(line.substr(0, pos));
+            strLine = transformRuleToCommon(temp, line, rule_group);
             allRules.emplace_back(strLine);
         }
     }
@@ -291,7 +281,6 @@ void rulesetToClash(YAML::Node &base_rule, std::vector<RulesetContent> &ruleset_
 std::string rulesetToClashStr(YAML::Node &base_rule, std::vector<RulesetContent> &ruleset_content_array, bool overwrite_original_rules, bool new_field_name)
 {
     std::string rule_group, retrieved_rules, strLine;
-    std::stringstream strStrm;
     const std::string field_name = new_field_name ? "rules" : "Rule";
     std::string output_content = "\n" + field_name + ":\n";
     size_t total_rules = 0;
@@ -352,27 +341,22 @@ std::string rulesetToClashStr(YAML::Node &base_rule, std::vector<RulesetContent>
             continue;
         }
         retrieved_rules = convertRuleset(retrieved_rules, x.rule_type);
-        char delimiter = getLineBreak(retrieved_rules);
-
-        strStrm.clear();
-        strStrm<<retrieved_rules;
-        std::string::size_type lineSize;
-        while(getline(strStrm, strLine, delimiter))
+        LineTokenizer lines(retrieved_rules);
+        std::string_view line;
+        string_size pos;
+        while(lines.next(line))
         {
             if(global.maxAllowedRules && total_rules > global.maxAllowedRules)
                 break;
-            strLine = trimWhitespace(strLine, true, true); //remove whitespaces
-            lineSize = strLine.size();
-            if(!lineSize || strLine[0] == ';' || strLine[0] == '#' || (lineSize >= 2 && strLine[0] == '/' && strLine[1] == '/')) //empty lines and comments are ignored
+            line = trimWhitespace(line, true, true); //remove whitespaces
+            if(line.empty() || line[0] == ';' || line[0] == '#' || line.starts_with("//")) //empty lines and comments are ignored
                 continue;
-            if(std::none_of(ClashRuleTypes.begin(), ClashRuleTypes.end(), [strLine](const std::string& type){ return startsWith(strLine, type); }))
+            if(std::none_of(ClashRuleTypes.begin(), ClashRuleTypes.end(), [line](const std::string& type){return line.starts_with(type);}))
                 continue;
-            if(strFind(strLine, "//"))
-            {
-                strLine.erase(strLine.find("//"));
-                strLine = trimWhitespace(strLine);
-            }
-            strLine = transformRuleToCommon(temp, strLine, rule_group);
+            pos = line.find("//");
+            if(pos != std::string_view::npos)
+                line = trimWhitespace(line.substr(0, pos));
+            strLine = transformRuleToCommon(temp, line, rule_group);
             output_content += "  - " + strLine + "\n";
             total_rules++;
         }
@@ -384,7 +368,6 @@ void rulesetToSurge(INIReader &base_rule, std::vector<RulesetContent> &ruleset_c
 {
     string_array allRules;
     std::string rule_group, rule_path, rule_path_typed, retrieved_rules, strLine;
-    std::stringstream strStrm;
     size_t total_rules = 0;
 
     std::string user_config = getUserConfiguration();
@@ -534,54 +517,49 @@ void rulesetToSurge(INIReader &base_rule, std::vector<RulesetContent> &ruleset_c
             }
 
             retrieved_rules = convertRuleset(retrieved_rules, x.rule_type);
-            char delimiter = getLineBreak(retrieved_rules);
-
-            strStrm.clear();
-            strStrm<<retrieved_rules;
-            std::string::size_type lineSize;
-            while(getline(strStrm, strLine, delimiter))
+            LineTokenizer lines(retrieved_rules);
+            std::string_view line;
+            string_size pos;
+            while(lines.next(line))
             {
                 if(global.maxAllowedRules && total_rules > global.maxAllowedRules)
                     break;
-                strLine = trimWhitespace(strLine, true, true);
-                lineSize = strLine.size();
-                if(!lineSize || strLine[0] == ';' || strLine[0] == '#' || (lineSize >= 2 && strLine[0] == '/' && strLine[1] == '/')) //empty lines and comments are ignored
+                line = trimWhitespace(line, true, true);
+                if(line.empty() || line[0] == ';' || line[0] == '#' || line.starts_with("//")) //empty lines and comments are ignored
                     continue;
 
                 /// remove unsupported types
                 switch(surge_ver)
                 {
                 case -2:
-                    if(startsWith(strLine, "IP-CIDR6"))
+                    if(line.starts_with("IP-CIDR6"))
                         continue;
                     [[fallthrough]];
                 case -1:
-                    if(!std::any_of(QuanXRuleTypes.begin(), QuanXRuleTypes.end(), [strLine](const std::string& type){return startsWith(strLine, type);}))
+                    if(!std::any_of(QuanXRuleTypes.begin(), QuanXRuleTypes.end(), [line](const std::string& type){return line.starts_with(type);}))
                         continue;
                     break;
                 case -3:
-                    if(!std::any_of(SurfRuleTypes.begin(), SurfRuleTypes.end(), [strLine](const std::string& type){return startsWith(strLine, type);}))
+                    if(!std::any_of(SurfRuleTypes.begin(), SurfRuleTypes.end(), [line](const std::string& type){return line.starts_with(type);}))
                         continue;
                     break;
                 default:
                     if(surge_ver > 2)
                     {
-                        if(!std::any_of(SurgeRuleTypes.begin(), SurgeRuleTypes.end(), [strLine](const std::string& type){return startsWith(strLine, type);}))
+                        if(!std::any_of(SurgeRuleTypes.begin(), SurgeRuleTypes.end(), [line](const std::string& type){return line.starts_with(type);}))
                             continue;
                     }
                     else
                     {
-                        if(!std::any_of(Surge2RuleTypes.begin(), Surge2RuleTypes.end(), [strLine](const std::string& type){return startsWith(strLine, type);}))
+                        if(!std::any_of(Surge2RuleTypes.begin(), Surge2RuleTypes.end(), [line](const std::string& type){return line.starts_with(type);}))
                             continue;
                     }
                 }
 
-                if(strFind(strLine, "//"))
-                {
-                    strLine.erase(strLine.find("//"));
-                    strLine = trimWhitespace(strLine);
-                }
-
+                pos = line.find("//");
+                if(pos != std::string_view::npos)
+                    line = trimWhitespace(line.substr(0, pos));
+                strLine = line;
                 if(surge_ver == -1 || surge_ver == -2)
                 {
                     if(startsWith(strLine, "IP-CIDR6"))
@@ -640,7 +618,7 @@ static rapidjson::Value transformRuleToSingBox(std::vector<std::string_view> &ar
     return rule_obj;
 }
 
-static void appendSingBoxRule(std::vector<std::string_view> &args, rapidjson::Value &rules, const std::string& rule, rapidjson::MemoryPoolAllocator<>& allocator)
+static void appendSingBoxRule(std::vector<std::string_view> &args, rapidjson::Value &rules, std::string_view rule, rapidjson::MemoryPoolAllocator<>& allocator)
 {
     using namespace rapidjson_ext;
     args.clear();
@@ -668,7 +646,6 @@ void rulesetToSingBox(rapidjson::Document &base_rule, std::vector<RulesetContent
 {
     using namespace rapidjson_ext;
     std::string rule_group, retrieved_rules, strLine, final;
-    std::stringstream strStrm;
     size_t total_rules = 0;
     auto &allocator = base_rule.GetAllocator();
 
@@ -715,28 +692,22 @@ void rulesetToSingBox(rapidjson::Document &base_rule, std::vector<RulesetContent
             continue;
         }
         retrieved_rules = convertRuleset(retrieved_rules, x.rule_type);
-        char delimiter = getLineBreak(retrieved_rules);
-
-        strStrm.clear();
-        strStrm<<retrieved_rules;
-
-        std::string::size_type lineSize;
+        LineTokenizer lines(retrieved_rules);
+        std::string_view line;
+        string_size pos;
         rapidjson::Value rule(rapidjson::kObjectType);
 
-        while(getline(strStrm, strLine, delimiter))
+        while(lines.next(line))
         {
             if(global.maxAllowedRules && total_rules > global.maxAllowedRules)
                 break;
-            strLine = trimWhitespace(strLine, true, true); //remove whitespaces
-            lineSize = strLine.size();
-            if(!lineSize || strLine[0] == ';' || strLine[0] == '#' || (lineSize >= 2 && strLine[0] == '/' && strLine[1] == '/')) //empty lines and comments are ignored
+            line = trimWhitespace(line, true, true); //remove whitespaces
+            if(line.empty() || line[0] == ';' || line[0] == '#' || line.starts_with("//")) //empty lines and comments are ignored
                 continue;
-            if(strFind(strLine, "//"))
-            {
-                strLine.erase(strLine.find("//"));
-                strLine = trimWhitespace(strLine);
-            }
-            appendSingBoxRule(temp, rule, strLine, allocator);
+            pos = line.find("//");
+            if(pos != std::string_view::npos)
+                line = trimWhitespace(line.substr(0, pos));
+            appendSingBoxRule(temp, rule, line, allocator);
         }
         if (rule.ObjectEmpty()) continue;
         rule.AddMember("outbound", rapidjson::Value(rule_group.c_str(), allocator), allocator);
@@ -4,12 +4,17 @@
 #include <cmath>
 #include <climits>
 #include <cstdio>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include "config/regmatch.h"
 #include "generator/config/subexport.h"
 #include "generator/template/templates.h"
 #include "handler/settings.h"
 #include "parser/config/proxy.h"
 #include "script/script_quickjs.h"
+#include "utils/base64/base64.h"
 #include "utils/bitwise.h"
 #include "utils/file_extra.h"
 #include "utils/ini_reader/ini_reader.h"
@@ -18,6 +23,7 @@
 #include "utils/rapidjson_extra.h"
 #include "utils/regexp.h"
 #include "utils/stl_extra.h"
+#include "utils/string_pool.h"
 #include "utils/urlencode.h"
 #include "utils/yamlcpp_extra.h"
 #include "nodemanip.h"
@@ -130,60 +136,132 @@ std::string vmessLinkConstruct(const std::string &remarks, const std::string &ad
     return sb.GetString();
 }
 
-bool matchRange(const std::string &range, int target)
+static std::vector<NodeMatcher::RangeTerm> compileRange(const std::string &range)
 {
+    std::vector<NodeMatcher::RangeTerm> terms;
     string_array vArray = split(range, ",");
-    bool match = false;
     std::string range_begin_str, range_end_str;
-    int range_begin, range_end;
     static const std::string reg_num = "-?\\d+", reg_range = "(\\d+)-(\\d+)", reg_not = "\\!-?(\\d+)", reg_not_range = "\\!(\\d+)-(\\d+)", reg_less = "(\\d+)-", reg_more = "(\\d+)\\+";
     for(std::string &x : vArray)
     {
+        NodeMatcher::RangeTerm term;
         if(regMatch(x, reg_num))
         {
-            if(to_int(x, INT_MAX) == target)
-                match = true;
+            term.op = NodeMatcher::RangeOp::Equal;
+            term.first = to_int(x, INT_MAX);
         }
-        else if(regMatch(x, reg_range))
+        else if(regMatch(x, reg_range) || regMatch(x, reg_not_range))
         {
+            term.op = startsWith(x, "!") ? NodeMatcher::RangeOp::NotBetween : NodeMatcher::RangeOp::Between;
             regGetMatch(x, reg_range, 3, 0, &range_begin_str, &range_end_str);
-            range_begin = to_int(range_begin_str, INT_MAX);
-            range_end = to_int(range_end_str, INT_MIN);
-            if(target >= range_begin && target <= range_end)
-                match = true;
+            term.first = to_int(range_begin_str, INT_MAX);
+            term.second = to_int(range_end_str, INT_MIN);
         }
         else if(regMatch(x, reg_not))
         {
-            match = true;
-            if(to_int(regReplace(x, reg_not, "$1"), INT_MAX) == target)
-                match = false;
-        }
-        else if(regMatch(x, reg_not_range))
-        {
-            match = true;
-            regGetMatch(x, reg_range, 3, 0, &range_begin_str, &range_end_str);
-            range_begin = to_int(range_begin_str, INT_MAX);
-            range_end = to_int(range_end_str, INT_MIN);
-            if(target >= range_begin && target <= range_end)
-                match = false;
+            term.op = NodeMatcher::RangeOp::NotEqual;
+            term.first = to_int(regReplace(x, reg_not, "$1"), INT_MAX);
         }
         else if(regMatch(x, reg_less))
         {
-            if(to_int(regReplace(x, reg_less, "$1"), INT_MAX) >= target)
-                match = true;
+            term.op = NodeMatcher::RangeOp::AtMost;
+            term.first = to_int(regReplace(x, reg_less, "$1"), INT_MAX);
         }
         else if(regMatch(x, reg_more))
         {
-            if(to_int(regReplace(x, reg_more, "$1"), INT_MIN) <= target)
+            term.op = NodeMatcher::RangeOp::AtLeast;
+            term.first = to_int(regReplace(x, reg_more, "$1"), INT_MIN);
+        }
+        else
+            continue;
+        terms.push_back(term);
+    }
+    return terms;
+}
+
+static bool matchRange(const std::vector<NodeMatcher::RangeTerm> &terms, int target)
+{
+    bool match = false;
+    /// negated terms reset the result, so the terms have to be evaluated in order
+    for(const NodeMatcher::RangeTerm &x : terms)
+    {
+        switch(x.op)
+        {
+        case NodeMatcher::RangeOp::Equal:
+            if(x.first == target)
                 match = true;
+            break;
+        case NodeMatcher::RangeOp::Between:
+            if(target >= x.first && target <= x.second)
+                match = true;
+            break;
+        case NodeMatcher::RangeOp::NotEqual:
+            match = x.first != target;
+            break;
+        case NodeMatcher::RangeOp::NotBetween:
+            match = !(target >= x.first && target <= x.second);
+            break;
+        case NodeMatcher::RangeOp::AtMost:
+            if(x.first >= target)
+                match = true;
+            break;
+        case NodeMatcher::RangeOp::AtLeast:
+            if(x.first <= target)
+                match = true;
+            break;
         }
     }
     return match;
 }
 
-bool applyMatcher(const std::string &rule, std::string &real_rule, const Proxy &node)
+bool NodeMatcher::matchNode(const Proxy &node) const
+{
+    switch(target)
+    {
+    case Target::Group:
+        return regFind(node.Group, pattern);
+    case Target::GroupId:
+        return matchRange(ranges, direction * node.GroupId);
+    case Target::Type:
+        if(node.Type == ProxyType::Unknown)
+            return false;
+        return type_mask & (1u << static_cast<int>(node.Type));
+    case Target::Port:
+        return matchRange(ranges, node.Port);
+    case Target::Server:
+        return regFind(node.Hostname, pattern);
+    default:
+        return true;
+    }
+}
+
+/// same as matchRemark() on every node, group patterns run once per distinct group name as providers repeat a few names across all their nodes
+std::vector<bool> NodeMatcher::matchRemarks(const ProxyRefs &nodes) const
+{
+    std::vector<bool> result(nodes.size(), false);
+    StringPool groups;
+    std::vector<bool> group_matched;
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        const Proxy &node = *nodes[i];
+        bool matched;
+        if(target == Target::Group)
+        {
+            uint32_t id = groups.intern(node.Group.str());
+            if(id == group_matched.size())
+                group_matched.push_back(regFind(node.Group, pattern));
+            matched = group_matched[id];
+        }
+        else
+            matched = matchNode(node);
+        result[i] = matched && (real_rule.empty() || regFind(node.Remark, remark));
+    }
+    return result;
+}
+
+static NodeMatcherPtr buildMatcher(const std::string &rule)
 {
-    std::string target, ret_real_rule;
+    std::string target;
     static const std::string groupid_regex = R"(^!!(?:GROUPID|INSERT)=([\d\-+!,]+)(?:!!(.*))?$)", group_regex = R"(^!!(?:GROUP)=(.+?)(?:!!(.*))?$)";
     static const std::string type_regex = R"(^!!(?:TYPE)=(.+?)(?:!!(.*))?$)", port_regex = R"(^!!(?:PORT)=(.+?)(?:!!(.*))?$)", server_regex = R"(^!!(?:SERVER)=(.+?)(?:!!(.*))?$)";
     static const std::map<ProxyType, const char *> types = {
@@ -199,42 +277,85 @@ bool applyMatcher(const std::string &rule, std::string &real_rule, const Proxy &
         {ProxyType::Hysteria,     "HYSTERIA"},
         {ProxyType::Hysteria2,    "HYSTERIA2"}
     };
+    auto matcher = std::make_shared<NodeMatcher>();
     if(startsWith(rule, "!!GROUP="))
     {
-        regGetMatch(rule, group_regex, 3, 0, &target, &ret_real_rule);
-        real_rule = ret_real_rule;
-        return regFind(node.Group, target);
+        regGetMatch(rule, group_regex, 3, 0, &target, &matcher->real_rule);
+        matcher->target = NodeMatcher::Target::Group;
+        matcher->pattern = regCompile(target);
     }
     else if(startsWith(rule, "!!GROUPID=") || startsWith(rule, "!!INSERT="))
     {
-        int dir = startsWith(rule, "!!INSERT=") ? -1 : 1;
-        regGetMatch(rule, groupid_regex, 3, 0, &target, &ret_real_rule);
-        real_rule = ret_real_rule;
-        return matchRange(target, dir * node.GroupId);
+        regGetMatch(rule, groupid_regex, 3, 0, &target, &matcher->real_rule);
+        matcher->target = NodeMatcher::Target::GroupId;
+        matcher->direction = startsWith(rule, "!!INSERT=") ? -1 : 1;
+        matcher->ranges = compileRange(target);
     }
     else if(startsWith(rule, "!!TYPE="))
     {
-        regGetMatch(rule, type_regex, 3, 0, &target, &ret_real_rule);
-        real_rule = ret_real_rule;
-        if(node.Type == ProxyType::Unknown)
-            return false;
-        return regMatch(types.at(node.Type), target);
+        regGetMatch(rule, type_regex, 3, 0, &target, &matcher->real_rule);
+        matcher->target = NodeMatcher::Target::Type;
+        for(auto &x : types)
+        {
+            if(regMatch(x.second, target))
+                matcher->type_mask |= 1u << static_cast<int>(x.first);
+        }
     }
     else if(startsWith(rule, "!!PORT="))
     {
-        regGetMatch(rule, port_regex, 3, 0, &target, &ret_real_rule);
-        real_rule = ret_real_rule;
-        return matchRange(target, node.Port);
+        regGetMatch(rule, port_regex, 3, 0, &target, &matcher->real_rule);
+        matcher->target = NodeMatcher::Target::Port;
+        matcher->ranges = compileRange(target);
     }
     else if(startsWith(rule, "!!SERVER="))
     {
-        regGetMatch(rule, server_regex, 3, 0, &target, &ret_real_rule);
-        real_rule = ret_real_rule;
-        return regFind(node.Hostname, target);
+        regGetMatch(rule, server_regex, 3, 0, &target, &matcher->real_rule);
+        matcher->target = NodeMatcher::Target::Server;
+        matcher->pattern = regCompile(target);
     }
     else
-        real_rule = rule;
-    return true;
+        matcher->real_rule = rule;
+    if(!matcher->real_rule.empty())
+        matcher->remark = regCompile(matcher->real_rule);
+    return matcher;
+}
+
+/// matchers are built on first use and kept in an LRU bounded like the compiled pattern cache they draw from
+NodeMatcherPtr compileMatcher(const std::string &rule)
+{
+    using entry_list = std::list<std::pair<std::string, NodeMatcherPtr>>;
+    static std::mutex cache_lock;
+    static entry_list entries;
+    static std::unordered_map<std::string, entry_list::iterator> index;
+    {
+        std::lock_guard<std::mutex> guard(cache_lock);
+        auto iter = index.find(rule);
+        if(iter != index.end())
+        {
+            entries.splice(entries.begin(), entries, iter->second);
+            return iter->second->second;
+        }
+    }
+    NodeMatcherPtr matcher = buildMatcher(rule);
+    std::lock_guard<std::mutex> guard(cache_lock);
+    auto iter = index.find(rule);
+    if(iter != index.end()) // another thread built the same matcher meanwhile
+        return iter->second->second;
+    entries.emplace_front(rule, matcher);
+    index.emplace(rule, entries.begin());
+    while(entries.size() > std::max<size_t>(global.regexCacheEntries, 1))
+    {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    return matcher;
+}
+
+bool applyMatcher(const std::string &rule, std::string &real_rule, const Proxy &node)
+{
+    NodeMatcherPtr matcher = compileMatcher(rule);
+    real_rule = matcher->real_rule;
+    return matcher->matchNode(node);
 }
 
 void processRemark(std::string &remark, const string_array &remarks_list, bool proc_comma = true)
@@ -262,38 +383,86 @@ void processRemark(std::string &remark, const string_array &remarks_list, bool p
     remark = tempRemark;
 }
 
-void groupGenerate(const std::string &rule, std::vector<Proxy> &nodelist, string_array &filtered_nodelist, bool add_direct, extra_settings &ext)
+struct GroupMemberTable
+{
+    const ProxyRefs *nodes = nullptr;
+    std::unordered_map<std::string, std::vector<bool>> matched; /// node membership of every distinct matcher rule
+};
+
+static bool isMatcherRule(const std::string &rule, bool add_direct, extra_settings &ext)
 {
-    std::string real_rule;
     if(startsWith(rule, "[]") && add_direct)
-    {
-        filtered_nodelist.emplace_back(rule.substr(2));
-    }
+        return false;
 #ifndef NO_JS_RUNTIME
-    else if(startsWith(rule, "script:") && ext.authorized)
+    if(startsWith(rule, "script:") && ext.authorized)
+        return false;
+#endif // NO_JS_RUNTIME
+    return true;
+}
+
+GroupMemberTable buildGroupMembers(const ProxyGroupConfigs &groups, const ProxyRefs &nodelist, bool add_direct, extra_settings &ext)
+{
+    GroupMemberTable table;
+    table.nodes = &nodelist;
+    /// rules shared by several groups are only evaluated once per node
+    for(const ProxyGroupConfig &x : groups)
     {
-        script_safe_runner(ext.js_runtime, ext.js_context, [&](qjs::Context &ctx){
-            std::string script = fileGet(rule.substr(7), true);
-            try
-            {
-                ctx.eval(script);
-                auto filter = (std::function<std::string(const std::vector<Proxy>&)>) ctx.eval("filter");
-                std::string result_list = filter(nodelist);
-                filtered_nodelist = split(regTrim(result_list), "\n");
-            }
-            catch (qjs::exception)
-            {
-                script_print_stack(ctx);
-            }
-        }, global.scriptCleanContext);
+        for(const std::string &y : x.Proxies)
+        {
+            if(!isMatcherRule(y, add_direct, ext) || table.matched.find(y) != table.matched.end())
+                continue;
+            table.matched.emplace(y, compileMatcher(y)->matchRemarks(nodelist));
+        }
     }
-#endif // NO_JS_RUNTIME
-    else
+    return table;
+}
+
+void groupGenerate(const ProxyGroupConfig &group, const GroupMemberTable &table, string_array &filtered_nodelist, bool add_direct, extra_settings &ext)
+{
+    const ProxyRefs &nodelist = *table.nodes;
+    std::unordered_set<std::string> added(filtered_nodelist.begin(), filtered_nodelist.end());
+    for(const std::string &rule : group.Proxies)
     {
-        for(Proxy &x : nodelist)
+        if(startsWith(rule, "[]") && add_direct)
         {
-            if(applyMatcher(rule, real_rule, x) && (real_rule.empty() || regFind(x.Remark, real_rule)) && std::find(filtered_nodelist.begin(), filtered_nodelist.end(), x.Remark) == filtered_nodelist.end())
-                filtered_nodelist.emplace_back(x.Remark);
+            filtered_nodelist.emplace_back(rule.substr(2));
+            added.insert(filtered_nodelist.back());
+        }
+#ifndef NO_JS_RUNTIME
+        else if(startsWith(rule, "script:") && ext.authorized)
+        {
+            script_safe_runner(ext.js_runtime, ext.js_context, [&](qjs::Context &ctx){
+                std::string script = fileGet(rule.substr(7), true);
+                try
+                {
+                    ctx.eval(script);
+                    auto filter = (std::function<std::string(const std::vector<Proxy>&)>) ctx.eval("filter");
+                    std::vector<Proxy> script_nodes;
+                    script_nodes.reserve(nodelist.size());
+                    for(const Proxy *x : nodelist)
+                        script_nodes.emplace_back(*x);
+                    std::string result_list = filter(script_nodes);
+                    filtered_nodelist = split(regTrim(result_list), "\n");
+                    added = std::unordered_set<std::string>(filtered_nodelist.begin(), filtered_nodelist.end());
+                }
+                catch (qjs::exception)
+                {
+                    script_print_stack(ctx);
+                }
+            }, global.scriptCleanContext);
+        }
+#endif // NO_JS_RUNTIME
+        else
+        {
+            auto iter = table.matched.find(rule);
+            if(iter == table.matched.end())
+                continue;
+            const std::vector<bool> &matched = iter->second;
+            for(size_t i = 0; i < matched.size(); i++)
+            {
+                if(matched[i] && added.insert(nodelist[i]->Remark).second)
+                    filtered_nodelist.emplace_back(nodelist[i]->Remark);
+            }
         }
     }
 }
@@ -301,7 +470,7 @@ void groupGenerate(const std::string &rule, std::vector<Proxy> &nodelist, string
 void proxyToClash(std::vector<Proxy> &nodes, YAML::Node &yamlnode, const ProxyGroupConfigs &extra_proxy_group, bool clashR, extra_settings &ext)
 {
     YAML::Node proxies, original_groups;
-    std::vector<Proxy> nodelist;
+    ProxyRefs nodelist;
     string_array remarks_list;
     /// proxies style
     bool proxy_block = false, proxy_compact = false, group_block = false, group_compact = false;
@@ -639,7 +808,7 @@ void proxyToClash(std::vector<Proxy> &nodes, YAML::Node &yamlnode, const ProxyGr
             singleproxy.SetStyle(YAML::EmitterStyle::Flow);
         proxies.push_back(singleproxy);
         remarks_list.emplace_back(x.Remark);
-        nodelist.emplace_back(x);
+        nodelist.emplace_back(&x);
     }
 
     if(proxy_compact)
@@ -659,6 +828,7 @@ void proxyToClash(std::vector<Proxy> &nodes, YAML::Node &yamlnode, const ProxyGr
         yamlnode["Proxy"] = proxies;
 
 
+    GroupMemberTable group_members = buildGroupMembers(extra_proxy_group, nodelist, true, ext);
     for(const ProxyGroupConfig &x : extra_proxy_group)
     {
         YAML::Node singlegroup;
@@ -697,8 +867,7 @@ void proxyToClash(std::vector<Proxy> &nodes, YAML::Node &yamlnode, const ProxyGr
         if(!x.DisableUdp.is_undef())
             singlegroup["disable-udp"] = x.DisableUdp.get();
 
-        for(const auto& y : x.Proxies)
-            groupGenerate(y, nodelist, filtered_nodelist, true, ext);
+        groupGenerate(x, group_members, filtered_nodelist, true, ext);
 
         if(!x.UsingProvider.empty())
             singlegroup["use"] = x.UsingProvider;
@@ -809,7 +978,7 @@ std::string proxyToSurge(std::vector<Proxy> &nodes, const std::string &base_conf
 {
     INIReader ini;
     std::string output_nodelist;
-    std::vector<Proxy> nodelist;
+    ProxyRefs nodelist;
     unsigned short local_port = 1080;
     string_array remarks_list;
 
@@ -843,7 +1012,8 @@ std::string proxyToSurge(std::vector<Proxy> &nodes, const std::string &base_conf
 
         processRemark(x.Remark, remarks_list);
 
-        std::string &hostname = x.Hostname, &username = x.Username, &password = x.Password, &method = x.EncryptMethod, &id = x.UserId, &transproto = x.TransferProtocol, &host = x.Host, &edge = x.Edge, &path = x.Path, &protocol = x.Protocol, &protoparam = x.ProtocolParam, &obfs = x.OBFS, &obfsparam = x.OBFSParam, &plugin = x.Plugin, &pluginopts = x.PluginOption, &underlying_proxy = x.UnderlyingProxy;
+        std::string &hostname = x.Hostname, &username = x.Username, &password = x.Password, &id = x.UserId, &edge = x.Edge, &path = x.Path, &protoparam = x.ProtocolParam, &obfsparam = x.OBFSParam, &plugin = x.Plugin, &pluginopts = x.PluginOption, &underlying_proxy = x.UnderlyingProxy;
+        InternedString &method = x.EncryptMethod, &transproto = x.TransferProtocol, &host = x.Host, &protocol = x.Protocol, &obfs = x.OBFS;
         std::string port = std::to_string(x.Port);
         bool &tlssecure = x.TLSSecure;
 
@@ -1038,7 +1208,7 @@ std::string proxyToSurge(std::vector<Proxy> &nodes, const std::string &base_conf
         else
         {
             ini.set("{NONAME}", x.Remark + " = " + proxy);
-            nodelist.emplace_back(x);
+            nodelist.emplace_back(&x);
         }
         remarks_list.emplace_back(x.Remark);
     }
@@ -1048,6 +1218,7 @@ std::string proxyToSurge(std::vector<Proxy> &nodes, const std::string &base_conf
 
     ini.set_current_section("Proxy Group");
     ini.erase_section();
+    GroupMemberTable group_members = buildGroupMembers(extra_proxy_group, nodelist, true, ext);
     for(const ProxyGroupConfig &x : extra_proxy_group)
     {
         string_array filtered_nodelist;
@@ -1073,8 +1244,7 @@ std::string proxyToSurge(std::vector<Proxy> &nodes, const std::string &base_conf
             continue;
         }
 
-        for(const auto &y : x.Proxies)
-            groupGenerate(y, nodelist, filtered_nodelist, true, ext);
+        groupGenerate(x, group_members, filtered_nodelist, true, ext);
 
         if(filtered_nodelist.empty())
             filtered_nodelist.emplace_back("DIRECT");
@@ -1121,11 +1291,14 @@ std::string proxyToSingle(std::vector<Proxy> &nodes, int types, extra_settings &
     /// types: SS=1 SSR=2 VMess=4 Trojan=8
     std::string proxyStr, allLinks;
     bool ss = GETBIT(types, 1), ssr = GETBIT(types, 2), vmess = GETBIT(types, 3), trojan = GETBIT(types, 4);
+    /// links are encoded as soon as they are built, so the plain list is never held in full
+    Base64StreamEncoder encoder;
 
     for(Proxy &x : nodes)
     {
         std::string remark = x.Remark;
-        std::string &hostname = x.Hostname, &password = x.Password, &method = x.EncryptMethod, &plugin = x.Plugin, &pluginopts = x.PluginOption, &protocol = x.Protocol, &protoparam = x.ProtocolParam, &obfs = x.OBFS, &obfsparam = x.OBFSParam, &id = x.UserId, &transproto = x.TransferProtocol, &host = x.Host, &path = x.Path, &faketype = x.FakeType;
+        std::string &hostname = x.Hostname, &password = x.Password, &plugin = x.Plugin, &pluginopts = x.PluginOption, &protoparam = x.ProtocolParam, &obfsparam = x.OBFSParam, &id = x.UserId, &path = x.Path, &faketype = x.FakeType;
+        InternedString &method = x.EncryptMethod, &protocol = x.Protocol, &obfs = x.OBFS, &transproto = x.TransferProtocol, &host = x.Host;
         bool &tlssecure = x.TLSSecure;
         std::string port = std::to_string(x.Port);
         std::string aid = std::to_string(x.AlterId);
@@ -1188,13 +1361,16 @@ std::string proxyToSingle(std::vector<Proxy> &nodes, int types, extra_settings &
         default:
             continue;
         }
-        allLinks += proxyStr + "\n";
+        proxyStr += "\n";
+        if(ext.nodelist)
+            allLinks += proxyStr;
+        else
+            encoder.feed(proxyStr.data(), proxyStr.size(), allLinks);
     }
 
-    if(ext.nodelist)
-        return allLinks;
-    else
-        return base64Encode(allLinks);
+    if(!ext.nodelist)
+        encoder.finish(allLinks);
+    return allLinks;
 }
 
 std::string proxyToSSSub(std::string base_conf, std::vector<Proxy> &nodes, extra_settings &ext)
@@ -1217,11 +1393,11 @@ std::string proxyToSSSub(std::string base_conf, std::vector<Proxy> &nodes, extra
         std::string &remark = x.Remark;
         std::string &hostname = x.Hostname;
         std::string &password = x.Password;
-        std::string &method = x.EncryptMethod;
+        InternedString &method = x.EncryptMethod;
         std::string &plugin = x.Plugin;
         std::string &pluginopts = x.PluginOption;
-        std::string &protocol = x.Protocol;
-        std::string &obfs = x.OBFS;
+        InternedString &protocol = x.Protocol;
+        InternedString &obfs = x.OBFS;
 
         switch(x.Type)
         {
@@ -1277,7 +1453,7 @@ std::string proxyToQuan(std::vector<Proxy> &nodes, const std::string &base_conf,
 void proxyToQuan(std::vector<Proxy> &nodes, INIReader &ini, std::vector<RulesetContent> &ruleset_content_array, const ProxyGroupConfigs &extra_proxy_group, extra_settings &ext)
 {
     std::string proxyStr;
-    std::vector<Proxy> nodelist;
+    ProxyRefs nodelist;
     string_array remarks_list;
 
     ini.set_current_section("SERVER");
@@ -1292,7 +1468,8 @@ void proxyToQuan(std::vector<Proxy> &nodes, INIReader &ini, std::vector<RulesetC
 
         processRemark(x.Remark, remarks_list);
 
-        std::string &hostname = x.Hostname, &method = x.EncryptMethod, &password = x.Password, &id = x.UserId, &transproto = x.TransferProtocol, &host = x.Host, &path = x.Path, &edge = x.Edge, &protocol = x.Protocol, &protoparam = x.ProtocolParam, &obfs = x.OBFS, &obfsparam = x.OBFSParam, &plugin = x.Plugin, &pluginopts = x.PluginOption, &username = x.Username;
+        std::string &hostname = x.Hostname, &password = x.Password, &id = x.UserId, &path = x.Path, &edge = x.Edge, &protoparam = x.ProtocolParam, &obfsparam = x.OBFSParam, &plugin = x.Plugin, &pluginopts = x.PluginOption, &username = x.Username;
+        InternedString &method = x.EncryptMethod, &transproto = x.TransferProtocol, &host = x.Host, &protocol = x.Protocol, &obfs = x.OBFS;
         std::string port = std::to_string(x.Port);
         bool &tlssecure = x.TLSSecure;
         tribool scv;
@@ -1403,7 +1580,7 @@ void proxyToQuan(std::vector<Proxy> &nodes, INIReader &ini, std::vector<RulesetC
 
         ini.set("{NONAME}", proxyStr);
         remarks_list.emplace_back(x.Remark);
-        nodelist.emplace_back(x);
+        nodelist.emplace_back(&x);
     }
 
     if(ext.nodelist)
@@ -1412,6 +1589,7 @@ void proxyToQuan(std::vector<Proxy> &nodes, INIReader &ini, std::vector<RulesetC
     ini.set_current_section("POLICY");
     ini.erase_section();
 
+    GroupMemberTable group_members = buildGroupMembers(extra_proxy_group, nodelist, true, ext);
     for(const ProxyGroupConfig &x : extra_proxy_group)
     {
         string_array filtered_nodelist;
@@ -1454,8 +1632,7 @@ void proxyToQuan(std::vector<Proxy> &nodes, INIReader &ini, std::vector<RulesetC
             continue;
         }
 
-        for(const auto &y : x.Proxies)
-            groupGenerate(y, nodelist, filtered_nodelist, true, ext);
+        groupGenerate(x, group_members, filtered_nodelist, true, ext);
 
         if(filtered_nodelist.empty())
             filtered_nodelist.emplace_back("direct");
@@ -1511,7 +1688,7 @@ void proxyToQuanX(std::vector<Proxy> &nodes, INIReader &ini, std::vector<Ruleset
 {
     std::string proxyStr;
     tribool udp, tfo, scv, tls13;
-    std::vector<Proxy> nodelist;
+    ProxyRefs nodelist;
     string_array remarks_list;
 
     ini.set_current_section("server_local");
@@ -1526,7 +1703,8 @@ void proxyToQuanX(std::vector<Proxy> &nodes, INIReader &ini, std::vector<Ruleset
 
         processRemark(x.Remark, remarks_list);
 
-        std::string &hostname = x.Hostname, &method = x.EncryptMethod, &id = x.UserId, &transproto = x.TransferProtocol, &host = x.Host, &path = x.Path, &password = x.Password, &plugin = x.Plugin, &pluginopts = x.PluginOption, &protocol = x.Protocol, &protoparam = x.ProtocolParam, &obfs = x.OBFS, &obfsparam = x.OBFSParam, &username = x.Username;
+        std::string &hostname = x.Hostname, &id = x.UserId, &path = x.Path, &password = x.Password, &plugin = x.Plugin, &pluginopts = x.PluginOption, &protoparam = x.ProtocolParam, &obfsparam = x.OBFSParam, &username = x.Username;
+        InternedString &method = x.EncryptMethod, &transproto = x.TransferProtocol, &host = x.Host, &protocol = x.Protocol, &obfs = x.OBFS;
         std::string port = std::to_string(x.Port);
         bool &tlssecure = x.TLSSecure;
 
@@ -1659,7 +1837,7 @@ void proxyToQuanX(std::vector<Proxy> &nodes, INIReader &ini, std::vector<Ruleset
 
         ini.set("{NONAME}", proxyStr);
         remarks_list.emplace_back(x.Remark);
-        nodelist.emplace_back(x);
+        nodelist.emplace_back(&x);
     }
 
     if(ext.nodelist)
@@ -1670,6 +1848,7 @@ void proxyToQuanX(std::vector<Proxy> &nodes, INIReader &ini, std::vector<Ruleset
     ini.get_items(original_groups);
     ini.erase_section();
 
+    GroupMemberTable group_members = buildGroupMembers(extra_proxy_group, nodelist, true, ext);
     for(const ProxyGroupConfig &x : extra_proxy_group)
     {
         std::string type;
@@ -1700,8 +1879,7 @@ void proxyToQuanX(std::vector<Proxy> &nodes, INIReader &ini, std::vector<Ruleset
 
         if(x.Type != ProxyGroupType::SSID)
         {
-            for(const auto &y : x.Proxies)
-                groupGenerate(y, nodelist, filtered_nodelist, true, ext);
+            groupGenerate(x, group_members, filtered_nodelist, true, ext);
 
             if(filtered_nodelist.empty())
                 filtered_nodelist.emplace_back("direct");
@@ -1787,7 +1965,8 @@ std::string proxyToSSD(std::vector<Proxy> &nodes, std::string &group, std::strin
 
     for(Proxy &x : nodes)
     {
-        std::string &hostname = x.Hostname, &password = x.Password, &method = x.EncryptMethod, &plugin = x.Plugin, &pluginopts = x.PluginOption, &protocol = x.Protocol, &obfs = x.OBFS;
+        std::string &hostname = x.Hostname, &password = x.Password, &plugin = x.Plugin, &pluginopts = x.PluginOption;
+        InternedString &method = x.EncryptMethod, &protocol = x.Protocol, &obfs = x.OBFS;
 
         switch(x.Type)
         {
@@ -1867,7 +2046,7 @@ void proxyToMellow(std::vector<Proxy> &nodes, INIReader &ini, std::vector<Rulese
     std::string id, aid, transproto, faketype, host, path, quicsecure, quicsecret, tlssecure;
     std::string url;
     tribool tfo, scv;
-    std::vector<Proxy> nodelist;
+    ProxyRefs nodelist;
     string_array vArray, remarks_list;
 
     ini.set_current_section("Endpoint");
@@ -1941,11 +2120,12 @@ void proxyToMellow(std::vector<Proxy> &nodes, INIReader &ini, std::vector<Rulese
 
         ini.set("{NONAME}", proxy);
         remarks_list.emplace_back(x.Remark);
-        nodelist.emplace_back(x);
+        nodelist.emplace_back(&x);
     }
 
     ini.set_current_section("EndpointGroup");
 
+    GroupMemberTable group_members = buildGroupMembers(extra_proxy_group, nodelist, false, ext);
     for(const ProxyGroupConfig &x : extra_proxy_group)
     {
         string_array filtered_nodelist;
@@ -1963,8 +2143,7 @@ void proxyToMellow(std::vector<Proxy> &nodes, INIReader &ini, std::vector<Rulese
             continue;
         }
 
-        for(const auto &y : x.Proxies)
-            groupGenerate(y, nodelist, filtered_nodelist, false, ext);
+        groupGenerate(x, group_members, filtered_nodelist, false, ext);
 
         if(filtered_nodelist.empty())
         {
@@ -2003,7 +2182,7 @@ std::string proxyToLoon(std::vector<Proxy> &nodes, const std::string &base_conf,
 {
     INIReader ini;
     std::string output_nodelist;
-    std::vector<Proxy> nodelist;
+    ProxyRefs nodelist;
 
     string_array remarks_list;
 
@@ -2027,7 +2206,8 @@ std::string proxyToLoon(std::vector<Proxy> &nodes, const std::string &base_conf,
         }
         processRemark(x.Remark, remarks_list);
 
-        std::string &hostname = x.Hostname, &username = x.Username, &password = x.Password, &method = x.EncryptMethod, &plugin = x.Plugin, &pluginopts = x.PluginOption, &id = x.UserId, &transproto = x.TransferProtocol, &host = x.Host, &path = x.Path, &protocol = x.Protocol, &protoparam = x.ProtocolParam, &obfs = x.OBFS, &obfsparam = x.OBFSParam;
+        std::string &hostname = x.Hostname, &username = x.Username, &password = x.Password, &plugin = x.Plugin, &pluginopts = x.PluginOption, &id = x.UserId, &path = x.Path, &protoparam = x.ProtocolParam, &obfsparam = x.OBFSParam;
+        InternedString &method = x.EncryptMethod, &transproto = x.TransferProtocol, &host = x.Host, &protocol = x.Protocol, &obfs = x.OBFS;
         std::string port = std::to_string(x.Port), aid = std::to_string(x.AlterId);
         bool &tlssecure = x.TLSSecure;
 
@@ -2135,7 +2315,7 @@ std::string proxyToLoon(std::vector<Proxy> &nodes, const std::string &base_conf,
         else
         {
             ini.set("{NONAME}", x.Remark + " = " + proxy);
-            nodelist.emplace_back(x);
+            nodelist.emplace_back(&x);
             remarks_list.emplace_back(x.Remark);
         }
     }
@@ -2148,6 +2328,7 @@ std::string proxyToLoon(std::vector<Proxy> &nodes, const std::string &base_conf,
     ini.get_items(original_groups);
     ini.erase_section();
 
+    GroupMemberTable group_members = buildGroupMembers(extra_proxy_group, nodelist, true, ext);
     for(const ProxyGroupConfig &x : extra_proxy_group)
     {
         string_array filtered_nodelist;
@@ -2171,8 +2352,7 @@ std::string proxyToLoon(std::vector<Proxy> &nodes, const std::string &base_conf,
             continue;
         }
 
-        for(const auto &y : x.Proxies)
-            groupGenerate(y, nodelist, filtered_nodelist, true, ext);
+        groupGenerate(x, group_members, filtered_nodelist, true, ext);
 
         if(filtered_nodelist.empty())
             filtered_nodelist.emplace_back("DIRECT");
@@ -2304,7 +2484,7 @@ void proxyToSingBox(std::vector<Proxy> &nodes, rapidjson::Document &json, std::v
     using namespace rapidjson_ext;
     rapidjson::Document::AllocatorType &allocator = json.GetAllocator();
     rapidjson::Value outbounds(rapidjson::kArrayType), route(rapidjson::kArrayType);
-    std::vector<Proxy> nodelist;
+    ProxyRefs nodelist;
     string_array remarks_list;
 
     if (!ext.nodelist)
@@ -2539,7 +2719,7 @@ void proxyToSingBox(std::vector<Proxy> &nodes, rapidjson::Document &json, std::v
         {
             proxy.AddMember("tcp_fast_open", buildBooleanValue(tfo), allocator);
         }
-        nodelist.push_back(x);
+        nodelist.emplace_back(&x);
         remarks_list.emplace_back(x.Remark);
         outbounds.PushBack(proxy, allocator);
     }
@@ -2550,6 +2730,7 @@ void proxyToSingBox(std::vector<Proxy> &nodes, rapidjson::Document &json, std::v
         return;
     }
 
+    GroupMemberTable group_members = buildGroupMembers(extra_proxy_group, nodelist, true, ext);
     for (const ProxyGroupConfig &x: extra_proxy_group)
     {
         string_array filtered_nodelist;
@@ -2571,8 +2752,7 @@ void proxyToSingBox(std::vector<Proxy> &nodes, rapidjson::Document &json, std::v
             default:
                 continue;
         }
-        for (const auto &y : x.Proxies)
-            groupGenerate(y, nodelist, filtered_nodelist, true, ext);
+        groupGenerate(x, group_members, filtered_nodelist, true, ext);
 
         if (filtered_nodelist.empty())
             filtered_nodelist.emplace_back("DIRECT");
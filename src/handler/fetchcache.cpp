@@ -0,0 +1,451 @@
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "handler/settings.h"
+#include "utils/file.h"
+#include "utils/lock.h"
+#include "utils/logger.h"
+#include "utils/md5/md5.h"
+#include "utils/string.h"
+#include "fetchcache.h"
+
+/*
+ * Record layout:
+ *   SUBCONVERTER-CACHE 1
+ *   url: <url>
+ *   fetch_time: <unix time>
+ *   ttl: <seconds>
+ *   status: <http status>
+ *   etag: <ETag of the response>
+ *   last_modified: <Last-Modified of the response>
+ *   headers_size: <bytes>
+ *   content_size: <bytes>
+ *   checksum: <md5 of headers and content>
+ *   <empty line>
+ *   <response headers><content>
+ */
+
+static const std::string cache_dir = "cache";
+static const std::string record_magic = "SUBCONVERTER-CACHE 1";
+static const std::string record_suffix = ".rec";
+
+struct CacheIndexEntry
+{
+    time_t fetch_time = 0;
+    /// refreshed by lookups that only hold the shard shared
+    std::atomic<time_t> last_access {0};
+    unsigned int ttl = 0;
+    size_t size = 0;
+};
+
+/// the index is split by the same key hash as the cache locks, lookups of different keys never wait for each other
+struct CacheIndexShard
+{
+    CountingSharedMutex lock;
+    std::unordered_map<std::string, CacheIndexEntry> entries;
+};
+
+static constexpr size_t index_shard_count = 64;
+static CacheIndexShard index_shards[index_shard_count];
+static std::once_flag index_loaded;
+static std::atomic<size_t> cache_entries {0}, cache_bytes {0}, cache_evictions {0}, cache_expirations {0};
+static std::mutex on_janitor;
+static std::condition_variable janitor_wakeup;
+static bool janitor_requested = false;
+
+static void startJanitor();
+
+static CacheIndexShard &indexShard(const std::string &key)
+{
+    return index_shards[keyStripe(key, index_shard_count)];
+}
+
+/// callers hold the shard exclusively
+static void indexPut(CacheIndexShard &shard, const std::string &key, time_t fetch_time, time_t last_access, unsigned int ttl, size_t size)
+{
+    auto result = shard.entries.try_emplace(key);
+    CacheIndexEntry &entry = result.first->second;
+    if(result.second)
+        cache_entries++;
+    else
+        cache_bytes -= entry.size;
+    cache_bytes += size;
+    entry.fetch_time = fetch_time;
+    entry.last_access = last_access;
+    entry.ttl = ttl;
+    entry.size = size;
+}
+
+static void indexErase(CacheIndexShard &shard, const std::string &key)
+{
+    auto iter = shard.entries.find(key);
+    if(iter == shard.entries.end())
+        return;
+    cache_bytes -= iter->second.size;
+    cache_entries--;
+    shard.entries.erase(iter);
+}
+
+static bool overBudget()
+{
+    return (global.cacheDiskSize > 0 && cache_bytes > static_cast<size_t>(global.cacheDiskSize)) ||
+           (global.cacheDiskEntries > 0 && cache_entries > static_cast<size_t>(global.cacheDiskEntries));
+}
+
+static std::string recordPath(const std::string &key)
+{
+    return cache_dir + "/" + key + record_suffix;
+}
+
+static std::string recordChecksum(const std::string &headers, const std::string &content)
+{
+    char result[MD5_STRING_SIZE];
+    md5::md5_t md5;
+    md5.process(headers.data(), headers.size());
+    md5.process(content.data(), content.size());
+    md5.finish();
+    md5.get_string(result);
+    return result;
+}
+
+static std::string singleLine(const std::string &value)
+{
+    std::string result = value;
+    for(char &c : result)
+    {
+        if(c == '\r' || c == '\n')
+            c = ' ';
+    }
+    return result;
+}
+
+/// parse the metadata block, returns the offset of the payload or npos if this is not a valid record
+static std::string::size_type parseRecordHeader(const std::string &data, CacheRecord &record, size_t &headers_size, size_t &content_size, std::string &checksum)
+{
+    std::string::size_type end = data.find("\n\n");
+    if(end == std::string::npos || data.compare(0, record_magic.size() + 1, record_magic + "\n") != 0)
+        return std::string::npos;
+    string_array lines = split(data.substr(record_magic.size() + 1, end - record_magic.size() - 1), "\n");
+    for(std::string &x : lines)
+    {
+        std::string::size_type pos = x.find(": ");
+        if(pos == std::string::npos)
+            continue;
+        std::string name = x.substr(0, pos), value = x.substr(pos + 2);
+        if(name == "url")
+            record.url = value;
+        else if(name == "fetch_time")
+            record.fetch_time = to_number<time_t>(value, 0);
+        else if(name == "ttl")
+            record.ttl = to_number<unsigned int>(value, 0);
+        else if(name == "status")
+            record.status = to_int(value, 0);
+        else if(name == "etag")
+            record.etag = value;
+        else if(name == "last_modified")
+            record.last_modified = value;
+        else if(name == "headers_size")
+            headers_size = to_number<size_t>(value, 0);
+        else if(name == "content_size")
+            content_size = to_number<size_t>(value, 0);
+        else if(name == "checksum")
+            checksum = value;
+    }
+    return end + 2;
+}
+
+/// read only the metadata block of a record file, used when building the index
+static bool readRecordHeader(const std::string &path, CacheRecord &record, size_t &file_size)
+{
+    std::ifstream file(path, std::ios::binary);
+    if(!file)
+        return false;
+    std::string data, line;
+    while(std::getline(file, line))
+    {
+        data += line;
+        data += "\n";
+        if(line.empty())
+            break;
+    }
+    file.seekg(0, std::ios::end);
+    file_size = static_cast<size_t>(file.tellg());
+    size_t headers_size = 0, content_size = 0;
+    std::string checksum;
+    std::string::size_type offset = parseRecordHeader(data, record, headers_size, content_size, checksum);
+    return offset != std::string::npos && offset + headers_size + content_size == file_size;
+}
+
+/// scan cache/ once, so that later lookups are answered from memory without touching the disk.
+/// every caller waits for the scan, it removes unfinished temporary files and has to happen before new ones are created
+static void loadIndex()
+{
+    std::call_once(index_loaded, []()
+    {
+        md(cache_dir.data());
+        operateFiles(cache_dir, [](const std::string &file)
+        {
+            std::string path = cache_dir + "/" + file;
+            if(!endsWith(file, record_suffix))
+            {
+                /// files of the old two-file layout and leftovers of interrupted writes
+                remove(path.data());
+                return 0;
+            }
+            CacheRecord record;
+            size_t file_size = 0;
+            if(readRecordHeader(path, record, file_size))
+            {
+                std::string key = file.substr(0, file.size() - record_suffix.size());
+                CacheIndexShard &shard = indexShard(key);
+                std::lock_guard<CountingSharedMutex> lock(shard.lock);
+                indexPut(shard, key, record.fetch_time, record.fetch_time, record.ttl, file_size);
+            }
+            else
+                remove(path.data());
+            return 0;
+        });
+        writeLog(0, "Loaded " + std::to_string(cache_entries) + " cache records.", LOG_LEVEL_INFO);
+        startJanitor();
+    });
+}
+
+/// remove up to max_count records: long expired and unused ones first, then least recently used ones until within budget.
+/// shards are visited one at a time and the candidates are sorted without holding any of them. a file is deleted
+/// while its shard is still held, so a record written again meanwhile is never deleted behind its new index entry
+static size_t removeVictims(size_t max_count)
+{
+    struct Candidate
+    {
+        time_t last_access;
+        size_t shard;
+        std::string key;
+
+        bool operator<(const Candidate &other) const { return last_access < other.last_access; }
+    };
+    size_t removed = 0;
+    std::vector<Candidate> by_access;
+    time_t now = time(nullptr);
+    long stale_window = std::max(global.cacheStaleWindow, 0);
+    for(size_t i = 0; i < index_shard_count && removed < max_count; i++)
+    {
+        CacheIndexShard &shard = index_shards[i];
+        std::lock_guard<CountingSharedMutex> lock(shard.lock);
+        for(auto iter = shard.entries.begin(); iter != shard.entries.end();)
+        {
+            /// an expired record is still useful for revalidation and as fallback while it is being requested
+            double idle_limit = static_cast<double>(iter->second.ttl) + stale_window;
+            time_t last_access = iter->second.last_access;
+            if(removed < max_count && difftime(now, iter->second.fetch_time) > idle_limit && difftime(now, last_access) > idle_limit)
+            {
+                remove(recordPath(iter->first).data());
+                removed++;
+                cache_expirations++;
+                cache_bytes -= iter->second.size;
+                cache_entries--;
+                iter = shard.entries.erase(iter);
+            }
+            else
+            {
+                by_access.push_back({last_access, i, iter->first});
+                ++iter;
+            }
+        }
+    }
+    if(removed >= max_count || !overBudget())
+        return removed;
+    std::sort(by_access.begin(), by_access.end());
+    for(Candidate &x : by_access)
+    {
+        if(!overBudget() || removed >= max_count)
+            break;
+        CacheIndexShard &shard = index_shards[x.shard];
+        std::lock_guard<CountingSharedMutex> lock(shard.lock);
+        auto iter = shard.entries.find(x.key);
+        /// skip records that were used or rewritten since the snapshot
+        if(iter == shard.entries.end() || iter->second.last_access != x.last_access)
+            continue;
+        indexErase(shard, x.key);
+        remove(recordPath(x.key).data());
+        removed++;
+        cache_evictions++;
+    }
+    return removed;
+}
+
+/// background thread that keeps cache/ within its budget, records are removed in small batches so readers are never blocked for long
+static void startJanitor()
+{
+    static bool started = false;
+    if(started)
+        return;
+    started = true;
+    std::thread([]()
+    {
+        constexpr size_t batch_size = 64;
+        while(true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(on_janitor);
+                janitor_wakeup.wait_for(lock, std::chrono::seconds(60), [](){ return janitor_requested; });
+                janitor_requested = false;
+            }
+            /// a full batch means more expired records may be waiting, a partial one over budget means some candidates were skipped
+            size_t removed;
+            do
+                removed = removeVictims(batch_size);
+            while(removed == batch_size || (removed && overBudget()));
+        }
+    }).detach();
+}
+
+static void dropRecord(const std::string &key)
+{
+    CacheIndexShard &shard = indexShard(key);
+    std::lock_guard<CountingSharedMutex> lock(shard.lock);
+    indexErase(shard, key);
+    remove(recordPath(key).data());
+}
+
+void cacheRecordInit()
+{
+    loadIndex();
+}
+
+bool cacheRecordFind(const std::string &key, time_t &fetch_time)
+{
+    loadIndex();
+    CacheIndexShard &shard = indexShard(key);
+    std::shared_lock<CountingSharedMutex> lock(shard.lock);
+    auto iter = shard.entries.find(key);
+    if(iter == shard.entries.end())
+        return false;
+    fetch_time = iter->second.fetch_time;
+    iter->second.last_access = time(nullptr);
+    return true;
+}
+
+bool cacheRecordRead(const std::string &key, CacheRecord &record)
+{
+    std::string data = fileGet(recordPath(key));
+    if(data.empty())
+    {
+        /// removed by the janitor after the lookup
+        CacheIndexShard &shard = indexShard(key);
+        std::lock_guard<CountingSharedMutex> lock(shard.lock);
+        indexErase(shard, key);
+        return false;
+    }
+    size_t headers_size = 0, content_size = 0;
+    std::string checksum;
+    std::string::size_type offset = parseRecordHeader(data, record, headers_size, content_size, checksum);
+    if(offset == std::string::npos || offset + headers_size + content_size != data.size())
+    {
+        writeLog(0, "Dropping truncated cache record '" + key + "'.", LOG_LEVEL_WARNING);
+        dropRecord(key);
+        return false;
+    }
+    record.headers.assign(data, offset, headers_size);
+    record.content.assign(data, offset + headers_size, content_size);
+    if(recordChecksum(record.headers, record.content) != checksum)
+    {
+        writeLog(0, "Dropping corrupted cache record '" + key + "'.", LOG_LEVEL_WARNING);
+        dropRecord(key);
+        return false;
+    }
+    return true;
+}
+
+bool cacheRecordWrite(const std::string &key, const CacheRecord &record)
+{
+    static std::atomic<unsigned int> write_id {0};
+    std::string data = record_magic + "\n";
+    data += "url: " + singleLine(record.url) + "\n";
+    data += "fetch_time: " + std::to_string(record.fetch_time) + "\n";
+    data += "ttl: " + std::to_string(record.ttl) + "\n";
+    data += "status: " + std::to_string(record.status) + "\n";
+    data += "etag: " + singleLine(record.etag) + "\n";
+    data += "last_modified: " + singleLine(record.last_modified) + "\n";
+    data += "headers_size: " + std::to_string(record.headers.size()) + "\n";
+    data += "content_size: " + std::to_string(record.content.size()) + "\n";
+    data += "checksum: " + recordChecksum(record.headers, record.content) + "\n\n";
+    data += record.headers;
+    data += record.content;
+
+    loadIndex();
+    /// write to a temporary file first, readers only ever see complete records
+    const std::string path = recordPath(key), temp_path = path + ".tmp" + std::to_string(write_id++);
+    std::FILE *fp = std::fopen(temp_path.data(), "wb");
+    if(!fp)
+        return false;
+    bool written = std::fwrite(data.data(), 1, data.size(), fp) == data.size();
+    written = std::fclose(fp) == 0 && written;
+    if(!written)
+    {
+        remove(temp_path.data());
+        return false;
+    }
+    {
+        /// the janitor deletes files under the shard lock, so moving the record in under it keeps the new file
+        CacheIndexShard &shard = indexShard(key);
+        std::lock_guard<CountingSharedMutex> lock(shard.lock);
+        std::error_code ec;
+        std::filesystem::rename(temp_path, path, ec);
+        if(ec)
+        {
+            remove(temp_path.data());
+            return false;
+        }
+        indexPut(shard, key, record.fetch_time, time(nullptr), record.ttl, data.size());
+    }
+    if(overBudget())
+    {
+        {
+            std::lock_guard<std::mutex> lock(on_janitor);
+            janitor_requested = true;
+        }
+        janitor_wakeup.notify_one();
+    }
+    return true;
+}
+
+void cacheRecordFlush()
+{
+    loadIndex();
+    /// take every shard in a fixed order, so that no record is added while the directory is emptied
+    for(CacheIndexShard &x : index_shards)
+        x.lock.lock();
+    operateFiles(cache_dir, [](const std::string &file){ remove((cache_dir + "/" + file).data()); return 0; });
+    for(CacheIndexShard &x : index_shards)
+        x.entries.clear();
+    cache_entries = 0;
+    cache_bytes = 0;
+    for(size_t i = index_shard_count; i > 0; i--)
+        index_shards[i - 1].lock.unlock();
+}
+
+CacheRecordStats cacheRecordStats()
+{
+    CacheRecordStats result;
+    result.entries = cache_entries;
+    result.bytes = cache_bytes;
+    result.evictions = cache_evictions;
+    result.expirations = cache_expirations;
+    for(CacheIndexShard &x : index_shards)
+    {
+        result.lock_acquired += x.lock.acquired();
+        result.lock_contended += x.lock.contended();
+    }
+    return result;
+}
@@ -0,0 +1,37 @@
+#ifndef FETCHCACHE_H_INCLUDED
+#define FETCHCACHE_H_INCLUDED
+
+#include <string>
+#include <ctime>
+
+/// a cached response, stored in cache/ as one record file holding both metadata and body
+struct CacheRecord
+{
+    std::string url;
+    time_t fetch_time = 0;
+    unsigned int ttl = 0;
+    int status = 0;
+    std::string etag;
+    std::string last_modified;
+    std::string headers;
+    std::string content;
+};
+
+struct CacheRecordStats
+{
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t evictions = 0;
+    size_t expirations = 0;
+    size_t lock_acquired = 0;
+    size_t lock_contended = 0;
+};
+
+void cacheRecordInit();
+bool cacheRecordFind(const std::string &key, time_t &fetch_time);
+bool cacheRecordRead(const std::string &key, CacheRecord &record);
+bool cacheRecordWrite(const std::string &key, const CacheRecord &record);
+void cacheRecordFlush();
+CacheRecordStats cacheRecordStats();
+
+#endif // FETCHCACHE_H_INCLUDED
@@ -629,12 +629,9 @@ std::string getRuleset(RESPONSE_CALLBACK_ARGS)
     }
 
     std::string strLine;
-    std::stringstream ss;
     const std::string rule_match_regex = "^(.*?,.*?)(,.*)(,.*)$";
 
-    ss << output_content;
-    char delimiter = getLineBreak(output_content);
-    std::string::size_type lineSize, posb, pose;
+    std::string::size_type posb, pose;
     auto filterLine = [&]()
     {
         posb = 0;
@@ -644,24 +641,25 @@ std::string getRuleset(RESPONSE_CALLBACK_ARGS)
         posb = pose + 1;
         pose = strLine.find(',', posb);
         if(pose == std::string::npos)
-        {
             pose = strLine.size();
-            if(strLine[pose - 1] == '\r')
-                pose--;
-        }
         pose -= posb;
         return 0;
     };
 
-    lineSize = output_content.size();
+    /// the lines point into the converted rules, the output is built in a fresh buffer
+    const std::string rules = std::move(output_content);
     output_content.clear();
-    output_content.reserve(lineSize);
+    output_content.reserve(rules.size());
 
     if(type_int == 3 || type_int == 4 || type_int == 6)
         output_content = "payload:\n";
 
-    while(getline(ss, strLine, delimiter))
+    LineTokenizer lines(rules);
+    std::string_view line;
+    while(lines.next(line))
     {
+        /// the rule filters and regReplace() work on std::string, each line is copied once here
+        strLine.assign(line);
         if(strFind(strLine, "//"))
         {
             strLine.erase(strLine.find("//"));
@@ -715,11 +713,7 @@ std::string getRuleset(RESPONSE_CALLBACK_ARGS)
             break;
         }
 
-        lineSize = strLine.size();
-        if(lineSize && strLine[lineSize - 1] == '\r') //remove line break
-            strLine.erase(--lineSize);
-
-        if(!strLine.empty() && (strLine[0] != ';' && strLine[0] != '#' && !(lineSize >= 2 && strLine[0] == '/' && strLine[1] == '/')))
+        if(!strLine.empty() && (strLine[0] != ';' && strLine[0] != '#' && !startsWith(strLine, "//")))
         {
             if(type_int == 2)
             {
@@ -1093,6 +1087,7 @@ std::string subconverter(RESPONSE_CALLBACK_ARGS)
     parse_set.js_runtime = ext.js_runtime;
     parse_set.js_context = ext.js_context;
 
+    std::vector<NodeLinkTask> link_tasks;
     if(!global.insertUrls.empty() && argEnableInsert)
     {
         groupID = -1;
@@ -1100,19 +1095,10 @@ std::string subconverter(RESPONSE_CALLBACK_ARGS)
         importItems(urls, true);
         for(std::string &x : urls)
         {
-            x = regTrim(x);
-            writeLog(0, "Fetching node data from url '" + x + "'.", LOG_LEVEL_INFO);
-            if(addNodes(x, insert_nodes, groupID, parse_set) == -1)
-            {
-                if(global.skipFailedLinks)
-                    writeLog(0, "The following link doesn't contain any valid node info: " + x, LOG_LEVEL_WARNING);
-                else
-                {
-                    *status_code = 400;
-                    return "The following link doesn't contain any valid node info: " + x;
-                }
-            }
-            groupID--;
+            NodeLinkTask task;
+            task.link = regTrim(x);
+            task.groupID = groupID--;
+            link_tasks.emplace_back(std::move(task));
         }
     }
     urls = split(argUrl, "|");
@@ -1120,20 +1106,32 @@ std::string subconverter(RESPONSE_CALLBACK_ARGS)
     groupID = 0;
     for(std::string &x : urls)
     {
-        x = regTrim(x);
+        NodeLinkTask task;
+        task.link = regTrim(x);
+        task.groupID = groupID++;
+        link_tasks.emplace_back(std::move(task));
+    }
+    for(NodeLinkTask &x : link_tasks)
+    {
         //std::cerr<<"Fetching node data from url '"<<x<<"'."<<std::endl;
-        writeLog(0, "Fetching node data from url '" + x + "'.", LOG_LEVEL_INFO);
-        if(addNodes(x, nodes, groupID, parse_set) == -1)
+        writeLog(0, "Fetching node data from url '" + x.link + "'.", LOG_LEVEL_INFO);
+    }
+    addNodesConcurrently(link_tasks, parse_set, global.maxConcurFetches);
+    for(NodeLinkTask &x : link_tasks)
+    {
+        if(x.result == -1)
         {
             if(global.skipFailedLinks)
-                writeLog(0, "The following link doesn't contain any valid node info: " + x, LOG_LEVEL_WARNING);
+                writeLog(0, "The following link doesn't contain any valid node info: " + x.link, LOG_LEVEL_WARNING);
             else
             {
                 *status_code = 400;
-                return "The following link doesn't contain any valid node info: " + x;
+                return "The following link doesn't contain any valid node info: " + x.link;
             }
         }
-        groupID++;
+        if(!x.sub_info.empty())
+            subInfo = x.sub_info;
+        copyNodes(x.nodes, x.groupID < 0 ? insert_nodes : nodes);
     }
     //exit if found nothing
     if(nodes.empty() && insert_nodes.empty())
@@ -1150,12 +1148,12 @@ std::string subconverter(RESPONSE_CALLBACK_ARGS)
     argPrependInsert.define(global.prependInsert);
     if(argPrependInsert)
     {
-        std::move(nodes.begin(), nodes.end(), std::back_inserter(insert_nodes));
+        copyNodes(nodes, insert_nodes);
         nodes.swap(insert_nodes);
     }
     else
     {
-        std::move(insert_nodes.begin(), insert_nodes.end(), std::back_inserter(nodes));
+        copyNodes(insert_nodes, nodes);
     }
     //run filter script
     std::string filterScript = global.filterScript;
@@ -1576,20 +1574,29 @@ std::string surgeConfToClash(RESPONSE_CALLBACK_ARGS)
     parse_set.request_header = &request.headers;
     parse_set.sub_info = &subInfo;
     parse_set.authorized = !global.APIMode;
+    std::vector<NodeLinkTask> link_tasks;
     for(std::string &x : links)
     {
         //std::cerr<<"Fetching node data from url '"<<x<<"'."<<std::endl;
         writeLog(0, "Fetching node data from url '" + x + "'.", LOG_LEVEL_INFO);
-        if(addNodes(x, nodes, 0, parse_set) == -1)
+        NodeLinkTask task;
+        task.link = x;
+        link_tasks.emplace_back(std::move(task));
+    }
+    addNodesConcurrently(link_tasks, parse_set, global.maxConcurFetches);
+    for(NodeLinkTask &x : link_tasks)
+    {
+        if(x.result == -1)
         {
             if(global.skipFailedLinks)
-                writeLog(0, "The following link doesn't contain any valid node info: " + x, LOG_LEVEL_WARNING);
+                writeLog(0, "The following link doesn't contain any valid node info: " + x.link, LOG_LEVEL_WARNING);
             else
             {
                 *status_code = 400;
-                return "The following link doesn't contain any valid node info: " + x;
+                return "The following link doesn't contain any valid node info: " + x.link;
             }
         }
+        copyNodes(x.nodes, nodes);
     }
 
     //exit if found nothing
@@ -1648,8 +1655,6 @@ std::string surgeConfToClash(RESPONSE_CALLBACK_ARGS)
     YAML::Node rule;
     string_array strArray;
     std::string strLine;
-    std::stringstream ss;
-    std::string::size_type lineSize;
     for(std::string &x : dummy_str_array)
     {
         if(startsWith(x, "RULE-SET"))
@@ -1661,24 +1666,20 @@ std::string surgeConfToClash(RESPONSE_CALLBACK_ARGS)
             if(content.empty())
                 continue;
 
-            ss << content;
-            char delimiter = getLineBreak(content);
-
-            while(getline(ss, strLine, delimiter))
+            LineTokenizer lines(content);
+            std::string_view line;
+            while(lines.next(line))
             {
-                lineSize = strLine.size();
-                if(lineSize && strLine[lineSize - 1] == '\r') //remove line break
-                    strLine.erase(--lineSize);
-                if(!lineSize || strLine[0] == ';' || strLine[0] == '#' || (lineSize >= 2 && strLine[0] == '/' && strLine[1] == '/')) //empty lines and comments are ignored
+                if(line.empty() || line[0] == ';' || line[0] == '#' || line.starts_with("//")) //empty lines and comments are ignored
                     continue;
-                else if(!std::any_of(ClashRuleTypes.begin(), ClashRuleTypes.end(), [&strLine](const std::string& type){return startsWith(strLine, type);})) //remove unsupported types
+                strLine.assign(line);
+                if(!std::any_of(ClashRuleTypes.begin(), ClashRuleTypes.end(), [&strLine](const std::string& type){return startsWith(strLine, type);})) //remove unsupported types
                     continue;
                 strLine += strArray[2];
                 if(count_least(strLine, ',', 3))
                     strLine = regReplace(strLine, "^(.*?,.*?)(,.*)(,.*)$", "$1$3$2");
                 rule.push_back(strLine);
             }
-            ss.clear();
             continue;
         }
         else if(!std::any_of(ClashRuleTypes.begin(), ClashRuleTypes.end(), [&strLine](const std::string& type){return startsWith(strLine, type);}))
@@ -1997,7 +1998,7 @@ int simpleGenerator()
             if(ini.get_bool("direct"))
             {
                 std::string url = ini.get("url");
-                content = fetchFile(url, proxy, global.cacheSubscription);
+                content = fetchFile(url, proxy, global.cacheSubscription, true, FetchPriority::Subscription);
                 if(content.empty())
                 {
                     //std::cerr<<"Artifact '"<<x<<"' generate ERROR! Please check your link.\n\n";
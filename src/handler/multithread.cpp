@@ -1,5 +1,13 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
 #include <future>
+#include <map>
+#include <queue>
 #include <thread>
+#include <vector>
 
 #include "handler/settings.h"
 #include "utils/network.h"
@@ -58,23 +66,243 @@ void safe_set_times(RegexMatchConfigs data)
     global.timeNodeRules.swap(data);
 }
 
-std::shared_future<std::string> fetchFileAsync(const std::string &path, const std::string &proxy, int cache_ttl, bool find_local, bool async)
+/// size-limited pool shared by all fetches, worker threads are created on demand up to max_fetch_threads
+class FetchExecutor
 {
+public:
+    void submit(FetchPriority priority, std::function<void()> task)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_queue.push({static_cast<int>(priority), m_sequence++, std::chrono::steady_clock::now(), std::move(task)});
+        m_max_queued = std::max(m_max_queued, m_queue.size());
+        /// a notified worker counts as idle until it gets the lock back, compare against the queue so that a burst of submits starts enough threads
+        if(m_queue.size() > m_idle && m_threads < static_cast<size_t>(std::max(global.maxFetchThreads, 1)))
+        {
+            m_threads++;
+            std::thread([this](){ work(); }).detach();
+        }
+        else
+            m_wakeup.notify_one();
+    }
+
+    FetchExecutorStats stats()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        FetchExecutorStats result;
+        result.threads = m_threads;
+        result.idle_threads = m_idle;
+        result.queued = m_queue.size();
+        result.max_queued = m_max_queued;
+        result.completed = m_completed;
+        result.total_wait_ms = m_total_wait_ms;
+        result.max_wait_ms = m_max_wait_ms;
+        return result;
+    }
+
+    static thread_local bool in_worker;
+
+private:
+    struct Item
+    {
+        int priority;
+        uint64_t sequence;
+        std::chrono::steady_clock::time_point queued_at;
+        std::function<void()> task;
+
+        bool operator<(const Item &other) const
+        {
+            /// std::priority_queue pops the largest element first
+            if(priority != other.priority)
+                return priority > other.priority;
+            return sequence > other.sequence;
+        }
+    };
+
+    void work()
+    {
+        in_worker = true;
+        std::unique_lock<std::mutex> lock(m_lock);
+        while(true)
+        {
+            m_idle++;
+            m_wakeup.wait(lock, [this](){ return !m_queue.empty(); });
+            m_idle--;
+            Item item = std::move(const_cast<Item&>(m_queue.top()));
+            m_queue.pop();
+            double wait_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - item.queued_at).count();
+            m_total_wait_ms += wait_ms;
+            m_max_wait_ms = std::max(m_max_wait_ms, wait_ms);
+            lock.unlock();
+            try
+            {
+                item.task();
+            }
+            catch(...) {}
+            lock.lock();
+            m_completed++;
+        }
+    }
+
+    std::mutex m_lock;
+    std::condition_variable m_wakeup;
+    std::priority_queue<Item> m_queue;
+    uint64_t m_sequence = 0;
+    size_t m_threads = 0, m_idle = 0, m_max_queued = 0, m_completed = 0;
+    double m_total_wait_ms = 0.0, m_max_wait_ms = 0.0;
+};
+
+thread_local bool FetchExecutor::in_worker = false;
+
+/// never destroyed, worker threads are detached and may outlive static destruction
+static FetchExecutor &fetchExecutor()
+{
+    static FetchExecutor *executor = new FetchExecutor();
+    return *executor;
+}
+
+void fetchExecute(FetchPriority priority, std::function<void()> task)
+{
+    fetchExecutor().submit(priority, std::move(task));
+}
+
+void fetchParallelFor(FetchPriority priority, size_t count, size_t helpers, const std::function<void(size_t)> &fn, const std::function<void()> &caller_first)
+{
+    struct ParallelJob
+    {
+        std::function<void(size_t)> fn;
+        size_t count = 0;
+        std::atomic<size_t> next {0};
+        size_t finished = 0;
+        std::exception_ptr error;
+        std::mutex lock;
+        std::condition_variable done;
+    };
+    /// helpers that start late still hold the job after this call returns, they find no index left and never call fn
+    auto job = std::make_shared<ParallelJob>();
+    job->fn = fn;
+    job->count = count;
+    auto work = [job]()
+    {
+        size_t index;
+        while((index = job->next++) < job->count)
+        {
+            std::exception_ptr error;
+            try
+            {
+                job->fn(index);
+            }
+            catch(...)
+            {
+                error = std::current_exception();
+            }
+            guarded_mutex guard(job->lock);
+            if(error && !job->error)
+                job->error = error;
+            if(++job->finished == job->count)
+                job->done.notify_all();
+        }
+    };
+    helpers = count > 0 ? std::min(helpers, count - 1) : 0;
+    for(size_t i = 0; i < helpers; i++)
+        fetchExecute(priority, work);
+    std::exception_ptr caller_error;
+    if(caller_first)
+    {
+        /// the helpers work on the caller's data, wait for them even when this fails
+        try
+        {
+            caller_first();
+        }
+        catch(...)
+        {
+            caller_error = std::current_exception();
+        }
+    }
+    work();
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> guard(job->lock);
+        job->done.wait(guard, [&](){ return job->finished == job->count; });
+        /// taken out of the job, which a late helper may be the last one to release
+        error = std::move(job->error);
+    }
+    if(caller_error)
+        std::rethrow_exception(caller_error);
+    if(error)
+        std::rethrow_exception(error);
+}
+
+bool inFetchExecutor()
+{
+    return FetchExecutor::in_worker;
+}
+
+FetchExecutorStats fetchExecutorStats()
+{
+    return fetchExecutor().stats();
+}
+
+/// run on the executor, or right here when already on one of its workers so that a full pool can not wait on itself
+template <typename Fn>
+static std::shared_future<std::string> fetchRun(FetchPriority priority, Fn &&fn)
+{
+    if(!inFetchExecutor())
+        return fetchSubmit(priority, std::forward<Fn>(fn));
+    std::promise<std::string> result;
+    try
+    {
+        result.set_value(fn());
+    }
+    catch(...)
+    {
+        result.set_exception(std::current_exception());
+    }
+    return result.get_future().share();
+}
+
+std::shared_future<std::string> fetchFileAsync(const std::string &path, const std::string &proxy, int cache_ttl, bool find_local, bool async, FetchPriority priority)
+{
+    /// requests for a file that is still being fetched join the running task
+    static std::mutex on_fetch;
+    static std::map<std::string, std::shared_future<std::string>> fetching;
+    const std::string key = proxy + "\n" + std::to_string(cache_ttl) + "\n" + std::to_string(find_local) + "\n" + path;
+
     std::shared_future<std::string> retVal;
-    /*if(vfs::vfs_exist(path))
-        retVal = std::async(std::launch::async, [path](){return vfs::vfs_get(path);});
-    else */if(find_local && fileExist(path, true))
-        retVal = std::async(std::launch::async, [path](){return fileGet(path, true);});
-    else if(isLink(path))
-        retVal = std::async(std::launch::async, [path, proxy, cache_ttl](){return webGet(path, proxy, cache_ttl);});
-    else
-        return std::async(std::launch::async, [](){return std::string();});
+    {
+        guarded_mutex guard(on_fetch);
+        for(auto iter = fetching.begin(); iter != fetching.end();)
+        {
+            if(iter->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                iter = fetching.erase(iter);
+            else
+                ++iter;
+        }
+        auto iter = fetching.find(key);
+        if(iter != fetching.end())
+            retVal = iter->second;
+        else
+        {
+            /*if(vfs::vfs_exist(path))
+                retVal = fetchRun(priority, [path](){return vfs::vfs_get(path);});
+            else */if(find_local && fileExist(path, true))
+                retVal = fetchRun(priority, [path](){return fileGet(path, true);});
+            else if(isLink(path))
+                retVal = fetchRun(priority, [path, proxy, cache_ttl](){return webGet(path, proxy, cache_ttl);});
+            else
+            {
+                std::promise<std::string> empty;
+                empty.set_value(std::string());
+                return empty.get_future().share();
+            }
+            fetching.emplace(key, retVal);
+        }
+    }
     if(!async)
         retVal.wait();
     return retVal;
 }
 
-std::string fetchFile(const std::string &path, const std::string &proxy, int cache_ttl, bool find_local)
+std::string fetchFile(const std::string &path, const std::string &proxy, int cache_ttl, bool find_local, FetchPriority priority)
 {
-    return fetchFileAsync(path, proxy, cache_ttl, find_local, false).get();
+    return fetchFileAsync(path, proxy, cache_ttl, find_local, false, priority).get();
 }
@@ -3,6 +3,9 @@
 
 #include <mutex>
 #include <future>
+#include <functional>
+#include <memory>
+#include <type_traits>
 
 #include <yaml-cpp/yaml.h>
 
@@ -22,7 +25,47 @@ void safe_set_emojis(RegexMatchConfigs data);
 void safe_set_renames(RegexMatchConfigs data);
 void safe_set_streams(RegexMatchConfigs data);
 void safe_set_times(RegexMatchConfigs data);
-std::shared_future<std::string> fetchFileAsync(const std::string &path, const std::string &proxy, int cache_ttl, bool find_local = true, bool async = false);
-std::string fetchFile(const std::string &path, const std::string &proxy, int cache_ttl, bool find_local = true);
+/// fetch tasks with a lower value are started first
+enum class FetchPriority
+{
+    Subscription,
+    Ruleset,
+    Config,
+    Background
+};
+
+struct FetchExecutorStats
+{
+    size_t threads = 0;
+    size_t idle_threads = 0;
+    size_t queued = 0;
+    size_t max_queued = 0;
+    size_t completed = 0;
+    double total_wait_ms = 0.0;
+    double max_wait_ms = 0.0;
+};
+
+void fetchExecute(FetchPriority priority, std::function<void()> task);
+/// call fn for every index below count on up to helpers executor tasks and the calling thread, returns when all calls are done.
+/// the calling thread claims indices as well, so a caller that is itself an executor worker never waits on a helper queued behind it.
+/// caller_first runs on the calling thread after the helpers are queued, for work that has to stay on it. the first exception is rethrown here
+void fetchParallelFor(FetchPriority priority, size_t count, size_t helpers, const std::function<void(size_t)> &fn, const std::function<void()> &caller_first = nullptr);
+bool inFetchExecutor();
+FetchExecutorStats fetchExecutorStats();
+
+/// run a task on the shared fetch executor and get its result through a future.
+/// the task is always queued, a worker that waits on it can hold up the pool, so work that may be waited on from a worker has to be claimable by the waiting thread as well
+template <typename Fn>
+std::shared_future<std::invoke_result_t<Fn>> fetchSubmit(FetchPriority priority, Fn &&fn)
+{
+    using result_type = std::invoke_result_t<Fn>;
+    auto task = std::make_shared<std::packaged_task<result_type()>>(std::forward<Fn>(fn));
+    std::shared_future<result_type> result = task->get_future().share();
+    fetchExecute(priority, [task](){ (*task)(); });
+    return result;
+}
+
+std::shared_future<std::string> fetchFileAsync(const std::string &path, const std::string &proxy, int cache_ttl, bool find_local = true, bool async = false, FetchPriority priority = FetchPriority::Config);
+std::string fetchFile(const std::string &path, const std::string &proxy, int cache_ttl, bool find_local = true, FetchPriority priority = FetchPriority::Config);
 
 #endif // MULTITHREAD_H_INCLUDED
@@ -14,6 +14,7 @@
 #include "server/webserver.h"
 #include "utils/logger.h"
 #include "utils/network.h"
+#include "utils/regexp.h"
 #include "interfaces.h"
 #include "multithread.h"
 #include "settings.h"
@@ -267,7 +268,7 @@ void refreshRulesets(RulesetConfigs &ruleset_list, std::vector<RulesetContent> &
         if(pos != std::string::npos)
         {
             writeLog(0, "Adding rule '" + rule_url.substr(pos + 2) + "," + rule_group + "'.", LOG_LEVEL_INFO);
-            rc = {rule_group, "", "", RULESET_SURGE, std::async(std::launch::async, [=](){return rule_url.substr(pos);}), 0};
+            rc = {rule_group, "", "", RULESET_SURGE, std::async(std::launch::deferred, [=](){return rule_url.substr(pos);}), 0};
         }
         else
         {
@@ -280,7 +281,7 @@ void refreshRulesets(RulesetConfigs &ruleset_list, std::vector<RulesetContent> &
                 type = iter->second;
             }
             writeLog(0, "Updating ruleset url '" + rule_url + "' with group '" + rule_group + "'.", LOG_LEVEL_INFO);
-            rc = {rule_group, rule_url, rule_url_typed, type, fetchFileAsync(rule_url, proxy, global.cacheRuleset, true, global.asyncFetchRuleset), x.Interval};
+            rc = {rule_group, rule_url, rule_url_typed, type, fetchFileAsync(rule_url, proxy, global.cacheRuleset, true, global.asyncFetchRuleset, FetchPriority::Ruleset), x.Interval};
         }
         ruleset_content_array.emplace_back(std::move(rc));
     }
@@ -550,9 +551,12 @@ void readYAMLConf(YAML::Node &node)
         }
         node["advanced"]["max_pending_connections"] >> global.maxPendingConns;
         node["advanced"]["max_concurrent_threads"] >> global.maxConcurThreads;
+        node["advanced"]["max_concurrent_fetches"] >> global.maxConcurFetches;
+        node["advanced"]["max_fetch_threads"] >> global.maxFetchThreads;
         node["advanced"]["max_allowed_rulesets"] >> global.maxAllowedRulesets;
         node["advanced"]["max_allowed_rules"] >> global.maxAllowedRules;
         node["advanced"]["max_allowed_download_size"] >> global.maxAllowedDownloadSize;
+        node["advanced"]["regex_cache_entries"] >> global.regexCacheEntries;
         if(node["advanced"]["enable_cache"].IsDefined())
         {
             if(safe_as<bool>(node["advanced"]["enable_cache"]))
@@ -561,14 +565,23 @@ void readYAMLConf(YAML::Node &node)
                 node["advanced"]["cache_config"] >> global.cacheConfig;
                 node["advanced"]["cache_ruleset"] >> global.cacheRuleset;
                 node["advanced"]["serve_cache_on_fetch_fail"] >> global.serveCacheOnFetchFail;
+                node["advanced"]["cache_memory_size"] >> global.cacheMemorySize;
+                node["advanced"]["cache_stale_window"] >> global.cacheStaleWindow;
+                node["advanced"]["cache_disk_size"] >> global.cacheDiskSize;
+                node["advanced"]["cache_disk_entries"] >> global.cacheDiskEntries;
+                node["advanced"]["cache_parsed_entries"] >> global.cacheParsedEntries;
             }
             else
+            {
                 global.cacheSubscription = global.cacheConfig = global.cacheRuleset = 0; //disable cache
+                global.cacheParsedEntries = 0;
+            }
         }
         node["advanced"]["script_clean_context"] >> global.scriptCleanContext;
         node["advanced"]["async_fetch_ruleset"] >> global.asyncFetchRuleset;
         node["advanced"]["skip_failed_links"] >> global.skipFailedLinks;
     }
+    regCacheSetCapacity(global.regexCacheEntries);
     writeLog(0, "Load preference settings in YAML format completed.", LOG_LEVEL_INFO);
 }
 
@@ -737,13 +750,21 @@ void readTOMLConf(toml::value &root)
                   "print_debug_info", global.printDbgInfo,
                   "max_pending_connections", global.maxPendingConns,
                   "max_concurrent_threads", global.maxConcurThreads,
+                  "max_concurrent_fetches", global.maxConcurFetches,
+                  "max_fetch_threads", global.maxFetchThreads,
                   "max_allowed_rulesets", global.maxAllowedRulesets,
                   "max_allowed_rules", global.maxAllowedRules,
                   "max_allowed_download_size", global.maxAllowedDownloadSize,
+                  "regex_cache_entries", global.regexCacheEntries,
                   "enable_cache", enable_cache,
                   "cache_subscription", cache_subscription,
                   "cache_config", cache_config,
                   "cache_ruleset", cache_ruleset,
+                  "cache_memory_size", global.cacheMemorySize,
+                  "cache_stale_window", global.cacheStaleWindow,
+                  "cache_disk_size", global.cacheDiskSize,
+                  "cache_disk_entries", global.cacheDiskEntries,
+                  "cache_parsed_entries", global.cacheParsedEntries,
                   "script_clean_context", global.scriptCleanContext,
                   "async_fetch_ruleset", global.asyncFetchRuleset,
                   "skip_failed_links", global.skipFailedLinks
@@ -784,8 +805,10 @@ void readTOMLConf(toml::value &root)
     else
     {
         global.cacheSubscription = global.cacheConfig = global.cacheRuleset = 0;
+        global.cacheParsedEntries = 0;
     }
 
+    regCacheSetCapacity(global.regexCacheEntries);
     writeLog(0, "Load preference settings in TOML format completed.", LOG_LEVEL_INFO);
 }
 
@@ -1055,9 +1078,12 @@ void readConf()
     }
     ini.get_int_if_exist("max_pending_connections", global.maxPendingConns);
     ini.get_int_if_exist("max_concurrent_threads", global.maxConcurThreads);
+    ini.get_int_if_exist("max_concurrent_fetches", global.maxConcurFetches);
+    ini.get_int_if_exist("max_fetch_threads", global.maxFetchThreads);
     ini.get_number_if_exist("max_allowed_rulesets", global.maxAllowedRulesets);
     ini.get_number_if_exist("max_allowed_rules", global.maxAllowedRules);
     ini.get_number_if_exist("max_allowed_download_size", global.maxAllowedDownloadSize);
+    ini.get_number_if_exist("regex_cache_entries", global.regexCacheEntries);
     if(ini.item_exist("enable_cache"))
     {
         if(ini.get_bool("enable_cache"))
@@ -1066,10 +1092,16 @@ void readConf()
             ini.get_int_if_exist("cache_config", global.cacheConfig);
             ini.get_int_if_exist("cache_ruleset", global.cacheRuleset);
             ini.get_bool_if_exist("serve_cache_on_fetch_fail", global.serveCacheOnFetchFail);
+            ini.get_number_if_exist("cache_memory_size", global.cacheMemorySize);
+            ini.get_int_if_exist("cache_stale_window", global.cacheStaleWindow);
+            ini.get_number_if_exist("cache_disk_size", global.cacheDiskSize);
+            ini.get_int_if_exist("cache_disk_entries", global.cacheDiskEntries);
+            ini.get_int_if_exist("cache_parsed_entries", global.cacheParsedEntries);
         }
         else
         {
             global.cacheSubscription = global.cacheConfig = global.cacheRuleset = 0; //disable cache
+            global.cacheParsedEntries = 0;
             global.serveCacheOnFetchFail = false;
         }
     }
@@ -1077,6 +1109,7 @@ void readConf()
     ini.get_bool_if_exist("async_fetch_ruleset", global.asyncFetchRuleset);
     ini.get_bool_if_exist("skip_failed_links", global.skipFailedLinks);
 
+    regCacheSetCapacity(global.regexCacheEntries);
     writeLog(0, "Load preference settings in INI format completed.", LOG_LEVEL_INFO);
 }
 
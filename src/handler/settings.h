@@ -23,7 +23,7 @@ struct Settings
     RegexMatchConfigs streamNodeRules, timeNodeRules;
     std::vector<RulesetContent> rulesetsContent;
     std::string listenAddress = "127.0.0.1", defaultUrls, insertUrls, managedConfigPrefix;
-    int listenPort = 25500, maxPendingConns = 10, maxConcurThreads = 4;
+    int listenPort = 25500, maxPendingConns = 10, maxConcurThreads = 4, maxConcurFetches = 8, maxFetchThreads = 16;
     bool prependInsert = true, skipFailedLinks = false;
     bool APIMode = true, writeManagedConfig = false, enableRuleGen = true, updateRulesetOnRequest = false, overwriteOriginalRules = true;
     bool printDbgInfo = false, CFWChildProcess = false, appendUserinfo = true, asyncFetchRuleset = false, surgeResolveHostname = true;
@@ -61,9 +61,15 @@ struct Settings
     //cache system
     bool serveCacheOnFetchFail = false;
     int cacheSubscription = 60, cacheConfig = 300, cacheRuleset = 21600;
+    long cacheMemorySize = 67108864L;
+    int cacheStaleWindow = 0;
+    long cacheDiskSize = 268435456L;
+    int cacheDiskEntries = 0;
+    int cacheParsedEntries = 16;
 
     //limits
     size_t maxAllowedRulesets = 64, maxAllowedRules = 32768;
+    size_t regexCacheEntries = 4096;
     bool scriptCleanContext = false;
 
     //cron system
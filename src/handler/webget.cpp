@@ -1,16 +1,26 @@
 #include <iostream>
 #include <unistd.h>
 #include <sys/stat.h>
-//#include <mutex>
+#include <mutex>
+#include <shared_mutex>
 #include <thread>
+#include <algorithm>
 #include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <curl/curl.h>
+#include "handler/fetchcache.h"
+#include "handler/multithread.h"
 #include "handler/settings.h"
 #include "utils/base64/base64.h"
 #include "utils/defer.h"
 #include "utils/file_extra.h"
 #include "utils/lock.h"
 #include "utils/logger.h"
+#include "utils/regexp.h"
+#include "utils/singleflight.h"
 #include "utils/urlencode.h"
 #include "version.h"
 #include "webget.h"
@@ -28,7 +38,7 @@ using guarded_mutex = std::lock_guard<std::mutex>;
 std::mutex cache_rw_lock;
 */
 
-RWLock cache_rw_lock;
+StripedRWLock cache_rw_lock;
 
 //std::string user_agent_str = "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/74.0.3729.169 Safari/537.36";
 static auto user_agent_str = "subconverter/" VERSION " cURL/" LIBCURL_VERSION;
@@ -40,12 +50,127 @@ struct curl_progress_data
 
 static inline void curl_init()
 {
-    static bool init = false;
-    if(!init)
+    static bool init = []()
     {
         curl_global_init(CURL_GLOBAL_ALL);
-        init = true;
+        return true;
+    }();
+    (void)init;
+}
+
+/// easy handles are kept idle after use so that their connection cache stays alive,
+/// while DNS and TLS sessions are also shared among all handles.
+/// connections are not shared, libcurl does not support that for handles running transfers on several threads at once
+class CurlHandlePool
+{
+public:
+    CurlHandlePool()
+    {
+        curl_init();
+        m_share = curl_share_init();
+        curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, lockShare);
+        curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+        curl_share_setopt(m_share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+
+    ~CurlHandlePool()
+    {
+        for(CURL *x : m_idle)
+            curl_easy_cleanup(x);
+        curl_share_cleanup(m_share);
+    }
+
+    CURL *acquire()
+    {
+        CURL *handle = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_pool_lock);
+            if(!m_idle.empty())
+            {
+                handle = m_idle.back();
+                m_idle.pop_back();
+            }
+        }
+        m_requests++;
+        if(handle)
+            m_handles_reused++;
+        else
+        {
+            handle = curl_easy_init();
+            m_handles_created++;
+        }
+        curl_easy_setopt(handle, CURLOPT_SHARE, m_share);
+        return handle;
+    }
+
+    void release(CURL *handle)
+    {
+        if(!handle)
+            return;
+        /// cookies set by one request must not leak into the next user of this handle
+        curl_easy_setopt(handle, CURLOPT_COOKIELIST, "ALL");
+        curl_easy_reset(handle);
+        {
+            std::lock_guard<std::mutex> lock(m_pool_lock);
+            if(m_idle.size() < max_idle_handles)
+            {
+                m_idle.push_back(handle);
+                return;
+            }
+        }
+        curl_easy_cleanup(handle);
+    }
+
+    void countConnection(bool reused)
+    {
+        if(reused)
+            m_reused_connections++;
+        else
+            m_new_connections++;
+    }
+
+    CurlPoolStats stats() const
+    {
+        CurlPoolStats result {};
+        result.requests = m_requests;
+        result.handles_created = m_handles_created;
+        result.handles_reused = m_handles_reused;
+        result.new_connections = m_new_connections;
+        result.reused_connections = m_reused_connections;
+        {
+            std::lock_guard<std::mutex> lock(m_pool_lock);
+            result.idle_handles = m_idle.size();
+        }
+        return result;
+    }
+
+private:
+    static constexpr size_t max_idle_handles = 32;
+
+    static void lockShare(CURL *, curl_lock_data data, curl_lock_access, void *userptr)
+    {
+        reinterpret_cast<CurlHandlePool*>(userptr)->m_share_locks[data % CURL_LOCK_DATA_LAST].lock();
+    }
+
+    static void unlockShare(CURL *, curl_lock_data data, void *userptr)
+    {
+        reinterpret_cast<CurlHandlePool*>(userptr)->m_share_locks[data % CURL_LOCK_DATA_LAST].unlock();
     }
+
+    CURLSH *m_share = nullptr;
+    std::mutex m_share_locks[CURL_LOCK_DATA_LAST];
+    mutable std::mutex m_pool_lock;
+    std::vector<CURL*> m_idle;
+    std::atomic<size_t> m_requests {0}, m_handles_created {0}, m_handles_reused {0};
+    std::atomic<size_t> m_new_connections {0}, m_reused_connections {0};
+};
+
+static CurlHandlePool &curlPool()
+{
+    static CurlHandlePool pool;
+    return pool;
 }
 
 static int writer(char *data, size_t size, size_t nmemb, std::string *writerData)
@@ -58,6 +183,14 @@ static int writer(char *data, size_t size, size_t nmemb, std::string *writerData
     return static_cast<int>(size * nmemb);
 }
 
+static int stream_writer(char *data, size_t size, size_t nmemb, FetchResult *result)
+{
+    result->content->append(data, size*nmemb);
+    (*result->on_content)(data, size*nmemb);
+
+    return static_cast<int>(size * nmemb);
+}
+
 static int dummy_writer(char *, size_t size, size_t nmemb, void *)
 {
     /// dummy writer, do not save anything
@@ -179,7 +312,8 @@ static int curlGet(const FetchArgument &argument, FetchResult &result)
         }
     }
 
-    curl_handle = curl_easy_init();
+    curl_handle = curlPool().acquire();
+    defer(curlPool().release(curl_handle);)
     if(!argument.proxy.empty())
     {
         if(startsWith(argument.proxy, "cors:"))
@@ -209,7 +343,12 @@ static int curlGet(const FetchArgument &argument, FetchResult &result)
     if(header_list)
         curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, header_list);
 
-    if(result.content)
+    if(result.content && result.on_content)
+    {
+        curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, stream_writer);
+        curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, &result);
+    }
+    else if(result.content)
     {
         curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, writer);
         curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, result.content);
@@ -266,9 +405,11 @@ static int curlGet(const FetchArgument &argument, FetchResult &result)
             fail_count++;
     }
 
-    long code = 0;
+    long code = 0, new_connects = 0;
     curl_easy_getinfo(curl_handle, CURLINFO_HTTP_CODE, &code);
     *result.status_code = code;
+    if(retVal == CURLE_OK && curl_easy_getinfo(curl_handle, CURLINFO_NUM_CONNECTS, &new_connects) == CURLE_OK)
+        curlPool().countConnection(new_connects == 0);
 
     if(result.cookies)
     {
@@ -287,8 +428,6 @@ static int curlGet(const FetchArgument &argument, FetchResult &result)
         curl_slist_free_all(cookies);
     }
 
-    curl_easy_cleanup(curl_handle);
-
     if(data && !argument.keep_resp_on_fail)
     {
         if(retVal != CURLE_OK || *result.status_code != 200)
@@ -299,6 +438,273 @@ static int curlGet(const FetchArgument &argument, FetchResult &result)
     return *result.status_code;
 }
 
+/// hot cache entries kept in memory in front of the cache/ directory, bounded by total bytes
+struct MemoryCacheEntry
+{
+    std::shared_ptr<const std::string> content;
+    std::shared_ptr<const std::string> headers;
+    time_t fetch_time = 0;
+
+    size_t size() const
+    {
+        return content->size() + headers->size();
+    }
+};
+
+class MemoryCache
+{
+public:
+    /// lookups only share the lock, recency is an atomic tick on the entry instead of a list splice
+    bool get(const std::string &key, MemoryCacheEntry &entry)
+    {
+        std::shared_lock<CountingSharedMutex> lock(m_lock);
+        auto iter = m_items.find(key);
+        if(iter == m_items.end())
+        {
+            m_misses++;
+            return false;
+        }
+        iter->second.last_use = ++m_tick;
+        entry = iter->second.entry;
+        m_hits++;
+        return true;
+    }
+
+    void put(const std::string &key, MemoryCacheEntry entry, size_t capacity)
+    {
+        std::lock_guard<CountingSharedMutex> lock(m_lock);
+        eraseItem(key);
+        if(entry.size() > capacity / 4)
+            return;
+        m_bytes += entry.size();
+        Item &item = m_items[key];
+        item.entry = std::move(entry);
+        item.last_use = ++m_tick;
+        if(m_bytes <= capacity)
+            return;
+        /// evictions are rare next to lookups, order the entries by last use only when over budget
+        std::vector<std::pair<size_t, std::string>> by_use;
+        by_use.reserve(m_items.size());
+        for(auto &x : m_items)
+            by_use.emplace_back(x.second.last_use, x.first);
+        std::sort(by_use.begin(), by_use.end());
+        for(auto &x : by_use)
+        {
+            if(m_bytes <= capacity)
+                break;
+            eraseItem(x.second);
+            m_evictions++;
+        }
+    }
+
+    void clear()
+    {
+        std::lock_guard<CountingSharedMutex> lock(m_lock);
+        m_items.clear();
+        m_bytes = 0;
+    }
+
+    void stats(CacheStats &result)
+    {
+        std::shared_lock<CountingSharedMutex> lock(m_lock);
+        result.memory_entries = m_items.size();
+        result.memory_bytes = m_bytes;
+        result.memory_hits = m_hits;
+        result.memory_misses = m_misses;
+        result.memory_evictions = m_evictions;
+        result.memory_lock_acquired = m_lock.acquired();
+        result.memory_lock_contended = m_lock.contended();
+    }
+
+private:
+    struct Item
+    {
+        MemoryCacheEntry entry;
+        std::atomic<size_t> last_use {0};
+    };
+
+    void eraseItem(const std::string &key)
+    {
+        auto iter = m_items.find(key);
+        if(iter == m_items.end())
+            return;
+        m_bytes -= iter->second.entry.size();
+        m_items.erase(iter);
+    }
+
+    CountingSharedMutex m_lock;
+    std::unordered_map<std::string, Item> m_items;
+    size_t m_bytes = 0, m_evictions = 0;
+    std::atomic<size_t> m_tick {0}, m_hits {0}, m_misses {0};
+};
+
+static MemoryCache memory_cache;
+
+static bool memoryCacheGet(const std::string &key, MemoryCacheEntry &entry)
+{
+    if(global.cacheMemorySize <= 0)
+        return false;
+    return memory_cache.get(key, entry);
+}
+
+static void memoryCachePut(const std::string &key, std::string content, std::string headers, time_t fetch_time)
+{
+    if(global.cacheMemorySize <= 0)
+        return;
+    MemoryCacheEntry entry;
+    entry.content = std::make_shared<const std::string>(std::move(content));
+    entry.headers = std::make_shared<const std::string>(std::move(headers));
+    entry.fetch_time = fetch_time;
+    memory_cache.put(key, std::move(entry), global.cacheMemorySize);
+}
+
+/// read the validators of a cached response, only the final response counts when redirects were followed
+static void getCacheValidators(const std::string &headers, std::string &etag, std::string &last_modified)
+{
+    std::string::size_type pos = headers.rfind("\nHTTP/");
+    std::string last_response = pos == std::string::npos ? headers : headers.substr(pos + 1);
+    regGetMatch(last_response, R"(^(?i:ETag): (.*?)\s*?$)", 2, 0, &etag);
+    regGetMatch(last_response, R"(^(?i:Last-Modified): (.*?)\s*?$)", 2, 0, &last_modified);
+}
+
+/// store a response in the disk cache and the memory tier
+static void cacheStore(const std::string &key, CacheRecord &record)
+{
+    {
+        cache_rw_lock.writeLock(key);
+        defer(cache_rw_lock.writeUnlock(key);)
+        cacheRecordWrite(key, record);
+    }
+    memoryCachePut(key, record.content, record.headers, record.fetch_time);
+}
+
+/// identical concurrent fetches are performed once and shared with every waiter
+struct FetchedContent
+{
+    std::string content;
+    std::string headers;
+};
+
+static SingleFlight<FetchedContent> fetch_flight;
+
+/// fetch a cache entry from upstream and store it, shared by foreground misses and background refreshes
+static FetchedContent refreshCacheEntry(const std::string &url, const std::string &proxy, unsigned int cache_ttl, const string_icase_map *request_headers, FetchStream *stream = nullptr)
+{
+    FetchedContent fetched;
+    const std::string url_md5 = getMD5(url);
+    /// another caller may have refreshed this entry while we were waiting
+    MemoryCacheEntry entry;
+    bool in_memory = memoryCacheGet(url_md5, entry);
+    if(in_memory && difftime(time(nullptr), entry.fetch_time) <= cache_ttl)
+    {
+        fetched.content = *entry.content;
+        fetched.headers = *entry.headers;
+        return fetched;
+    }
+    /// the expired copy supplies validators for a conditional request, and is served again on 304
+    CacheRecord stale;
+    time_t stale_time = 0;
+    bool has_stale = false;
+    if(in_memory)
+    {
+        stale.url = url;
+        stale.fetch_time = entry.fetch_time;
+        stale.ttl = cache_ttl;
+        stale.status = 200;
+        stale.headers = *entry.headers;
+        stale.content = *entry.content;
+        getCacheValidators(stale.headers, stale.etag, stale.last_modified);
+        has_stale = true;
+    }
+    else if(cacheRecordFind(url_md5, stale_time))
+    {
+        cache_rw_lock.readLock(url_md5);
+        defer(cache_rw_lock.readUnlock(url_md5);)
+        has_stale = cacheRecordRead(url_md5, stale);
+    }
+    string_icase_map conditional_headers;
+    if(request_headers)
+        conditional_headers = *request_headers;
+    if(has_stale && !stale.etag.empty())
+        conditional_headers["If-None-Match"] = stale.etag;
+    if(has_stale && !stale.last_modified.empty())
+        conditional_headers["If-Modified-Since"] = stale.last_modified;
+    FetchArgument conditional {HTTP_GET, url, proxy, nullptr, &conditional_headers, nullptr, cache_ttl};
+    /// always keep the headers of cached responses, so that later callers asking for them are served from cache too
+    int return_code = 0;
+    FetchResult fetch_res {&return_code, &fetched.content, &fetched.headers, nullptr, stream ? &stream->on_content : nullptr};
+    //content = curlGet(url, proxy, response_headers, return_code); // try to fetch data
+    curlGet(conditional, fetch_res);
+    if(return_code == 304 && has_stale) // not modified, refresh the timestamp of the old cache
+    {
+        writeLog(0, "CACHE REVALIDATED: '" + url + "', content not modified.");
+        stale.fetch_time = time(nullptr);
+        stale.ttl = cache_ttl;
+        cacheStore(url_md5, stale);
+        fetched.content = std::move(stale.content);
+        fetched.headers = std::move(stale.headers);
+    }
+    else if(return_code == 200) // success, save new cache
+    {
+        CacheRecord record;
+        record.url = url;
+        record.fetch_time = time(nullptr);
+        record.ttl = cache_ttl;
+        record.status = return_code;
+        record.headers = fetched.headers;
+        record.content = fetched.content;
+        getCacheValidators(record.headers, record.etag, record.last_modified);
+        cacheStore(url_md5, record);
+        if(stream && !fetched.content.empty())
+            stream->delivered = true;
+    }
+    else
+    {
+        if(has_stale && global.serveCacheOnFetchFail) // failed, check if cache exist
+        {
+            writeLog(0, "Fetch failed. Serving cached content."); // cache exist, serving cache
+            fetched.content = std::move(stale.content);
+            fetched.headers = std::move(stale.headers);
+        }
+        else
+            writeLog(0, "Fetch failed. No local cache available."); // cache not exist or not allow to serve cache, serving nothing
+    }
+    return fetched;
+}
+
+/// refresh an entry that is being served stale, at most one background refresh per url and proxy
+static void refreshCacheEntryAsync(const std::string &url, const std::string &proxy, unsigned int cache_ttl, const string_icase_map *request_headers)
+{
+    static std::mutex on_refresh;
+    static std::unordered_set<std::string> refreshing;
+    std::string key = proxy + "\n" + url;
+    {
+        std::lock_guard<std::mutex> lock(on_refresh);
+        if(!refreshing.insert(key).second)
+            return;
+    }
+    string_icase_map headers;
+    if(request_headers)
+        headers = *request_headers;
+    fetchExecute(FetchPriority::Background, [=]()
+    {
+        writeLog(0, "Refreshing stale cache of '" + url + "' in background.");
+        try
+        {
+            fetch_flight.run(key, [&]()
+            {
+                return refreshCacheEntry(url, proxy, cache_ttl, &headers);
+            });
+        }
+        catch(std::exception &e)
+        {
+            writeLog(0, "Background refresh of '" + url + "' failed: " + e.what(), LOG_LEVEL_ERROR);
+        }
+        std::lock_guard<std::mutex> lock(on_refresh);
+        refreshing.erase(key);
+    });
+}
+
 // data:[<mediatype>][;base64],<data>
 static std::string dataGet(const std::string &url)
 {
@@ -323,79 +729,115 @@ std::string buildSocks5ProxyString(const std::string &addr, int port, const std:
     return proxystr;
 }
 
-std::string webGet(const std::string &url, const std::string &proxy, unsigned int cache_ttl, std::string *response_headers, string_icase_map *request_headers)
+std::string webGet(const std::string &url, const std::string &proxy, unsigned int cache_ttl, std::string *response_headers, string_icase_map *request_headers, FetchStream *stream)
 {
     int return_code = 0;
-    std::string content;
 
     FetchArgument argument {HTTP_GET, url, proxy, nullptr, request_headers, nullptr, cache_ttl};
-    FetchResult fetch_res {&return_code, &content, response_headers, nullptr};
 
     if (startsWith(url, "data:"))
         return dataGet(url);
     // cache system
     if(cache_ttl > 0)
     {
-        md("cache");
         const std::string url_md5 = getMD5(url);
-        const std::string path = "cache/" + url_md5, path_header = path + "_header";
-        struct stat result {};
-        if(stat(path.data(), &result) == 0) // cache exist
+        const double stale_limit = static_cast<double>(cache_ttl) + std::max(global.cacheStaleWindow, 0);
+        MemoryCacheEntry entry;
+        time_t now = time(nullptr);
+        if(memoryCacheGet(url_md5, entry))
         {
-            time_t mtime = result.st_mtime, now = time(nullptr); // get cache modified time and current time
-            if(difftime(now, mtime) <= cache_ttl) // within TTL
+            double age = difftime(now, entry.fetch_time);
+            if(age <= stale_limit)
             {
-                writeLog(0, "CACHE HIT: '" + url + "', using local cache.");
-                //guarded_mutex guard(cache_rw_lock);
-                cache_rw_lock.readLock();
-                defer(cache_rw_lock.readUnlock();)
+                if(age <= cache_ttl)
+                    writeLog(0, "CACHE HIT: '" + url + "', using memory cache.");
+                else
+                {
+                    writeLog(0, "CACHE STALE: '" + url + "', using memory cache while refreshing.");
+                    refreshCacheEntryAsync(url, proxy, cache_ttl, request_headers);
+                }
                 if(response_headers)
-                    *response_headers = fileGet(path_header, true);
-                return fileGet(path, true);
+                    *response_headers = *entry.headers;
+                return *entry.content;
             }
-            writeLog(0, "CACHE MISS: '" + url + "', TTL timeout, creating new cache."); // out of TTL
         }
-        else
-            writeLog(0, "CACHE NOT EXIST: '" + url + "', creating new cache.");
-        //content = curlGet(url, proxy, response_headers, return_code); // try to fetch data
-        curlGet(argument, fetch_res);
-        if(return_code == 200) // success, save new cache
+        time_t fetch_time = 0;
+        if(cacheRecordFind(url_md5, fetch_time)) // cache exist
         {
-            //guarded_mutex guard(cache_rw_lock);
-            cache_rw_lock.writeLock();
-            defer(cache_rw_lock.writeUnlock();)
-            fileWrite(path, content, true);
-            if(response_headers)
-                fileWrite(path_header, *response_headers, true);
-        }
-        else
-        {
-            if(fileExist(path) && global.serveCacheOnFetchFail) // failed, check if cache exist
+            double age = difftime(now, fetch_time);
+            CacheRecord record;
+            bool loaded = false;
+            if(age <= stale_limit) // within TTL or the stale window
             {
-                writeLog(0, "Fetch failed. Serving cached content."); // cache exist, serving cache
-                //guarded_mutex guard(cache_rw_lock);
-                cache_rw_lock.readLock();
-                defer(cache_rw_lock.readUnlock();)
-                content = fileGet(path, true);
+                cache_rw_lock.readLock(url_md5);
+                defer(cache_rw_lock.readUnlock(url_md5);)
+                loaded = cacheRecordRead(url_md5, record);
+            }
+            if(loaded)
+            {
+                if(age <= cache_ttl)
+                    writeLog(0, "CACHE HIT: '" + url + "', using local cache.");
+                else
+                    writeLog(0, "CACHE STALE: '" + url + "', using local cache while refreshing.");
                 if(response_headers)
-                    *response_headers = fileGet(path_header, true);
+                    *response_headers = record.headers;
+                memoryCachePut(url_md5, record.content, record.headers, record.fetch_time);
+                if(age > cache_ttl)
+                    refreshCacheEntryAsync(url, proxy, cache_ttl, request_headers);
+                return std::move(record.content);
             }
-            else
-                writeLog(0, "Fetch failed. No local cache available."); // cache not exist or not allow to serve cache, serving nothing
+            writeLog(0, "CACHE MISS: '" + url + "', TTL timeout, creating new cache."); // out of TTL
         }
-        return content;
+        else
+            writeLog(0, "CACHE NOT EXIST: '" + url + "', creating new cache.");
+        FetchedContent fetched = fetch_flight.run(proxy + "\n" + url, [&]()
+        {
+            /// only the caller doing the fetch sees the body early, the others get the finished content
+            return refreshCacheEntry(url, proxy, cache_ttl, request_headers, stream);
+        });
+        if(response_headers)
+            *response_headers = std::move(fetched.headers);
+        return std::move(fetched.content);
+    }
+    /// uncached requests are only shared with callers sending exactly the same headers
+    std::string flight_key = proxy + "\n" + url;
+    if(request_headers)
+    {
+        for(auto &x : *request_headers)
+            flight_key += "\n" + x.first + ": " + x.second;
     }
-    //return curlGet(url, proxy, response_headers, return_code);
-    curlGet(argument, fetch_res);
-    return content;
+    FetchedContent fetched = fetch_flight.run(flight_key, [&]()
+    {
+        FetchedContent fetched;
+        FetchResult fetch_res {&return_code, &fetched.content, &fetched.headers, nullptr, stream ? &stream->on_content : nullptr};
+        //return curlGet(url, proxy, response_headers, return_code);
+        curlGet(argument, fetch_res);
+        if(stream && return_code == 200 && !fetched.content.empty())
+            stream->delivered = true;
+        return fetched;
+    });
+    if(response_headers)
+        *response_headers = std::move(fetched.headers);
+    return std::move(fetched.content);
 }
 
 void flushCache()
 {
-    //guarded_mutex guard(cache_rw_lock);
-    cache_rw_lock.writeLock();
-    defer(cache_rw_lock.writeUnlock();)
-    operateFiles("cache", [](const std::string &file){ remove(("cache/" + file).data()); return 0; });
+    cache_rw_lock.writeLockAll();
+    defer(cache_rw_lock.writeUnlockAll();)
+    cacheRecordFlush();
+    memory_cache.clear();
+}
+
+CacheStats webGetCacheStats()
+{
+    CacheStats result {};
+    memory_cache.stats(result);
+    result.fetches_executed = fetch_flight.executed();
+    result.fetches_coalesced = fetch_flight.shared();
+    result.lock_acquired = cache_rw_lock.acquired();
+    result.lock_contended = cache_rw_lock.contended();
+    return result;
 }
 
 int webPost(const std::string &url, const std::string &data, const std::string &proxy, const string_icase_map &request_headers, std::string *retData)
@@ -437,3 +879,8 @@ int webGet(const FetchArgument& argument, FetchResult &result)
 {
     return curlGet(argument, result);
 }
+
+CurlPoolStats webGetPoolStats()
+{
+    return curlPool().stats();
+}
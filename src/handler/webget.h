@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include <functional>
 
 #include "utils/map_extra.h"
 #include "utils/string.h"
@@ -33,11 +34,48 @@ struct FetchResult
     std::string *content = nullptr;
     std::string *response_headers = nullptr;
     std::string *cookies = nullptr;
+    /// called with each piece of content as it arrives
+    const std::function<void(const char*, size_t)> *on_content = nullptr;
+};
+
+/// lets the caller look at a body while it is being downloaded
+struct FetchStream
+{
+    std::function<void(const char*, size_t)> on_content;
+    /// set when the returned content is exactly what was passed to on_content
+    bool delivered = false;
+};
+
+struct CurlPoolStats
+{
+    size_t requests = 0;
+    size_t handles_created = 0;
+    size_t handles_reused = 0;
+    size_t idle_handles = 0;
+    size_t new_connections = 0;
+    size_t reused_connections = 0;
+};
+
+struct CacheStats
+{
+    size_t memory_entries = 0;
+    size_t memory_bytes = 0;
+    size_t memory_hits = 0;
+    size_t memory_misses = 0;
+    size_t memory_evictions = 0;
+    size_t memory_lock_acquired = 0;
+    size_t memory_lock_contended = 0;
+    size_t fetches_executed = 0;
+    size_t fetches_coalesced = 0;
+    size_t lock_acquired = 0;
+    size_t lock_contended = 0;
 };
 
 int webGet(const FetchArgument& argument, FetchResult &result);
-std::string webGet(const std::string &url, const std::string &proxy = "", unsigned int cache_ttl = 0, std::string *response_headers = nullptr, string_icase_map *request_headers = nullptr);
+std::string webGet(const std::string &url, const std::string &proxy = "", unsigned int cache_ttl = 0, std::string *response_headers = nullptr, string_icase_map *request_headers = nullptr, FetchStream *stream = nullptr);
 void flushCache();
+CurlPoolStats webGetPoolStats();
+CacheStats webGetCacheStats();
 int webPost(const std::string &url, const std::string &data, const std::string &proxy, const string_icase_map &request_headers, std::string *retData);
 int webPatch(const std::string &url, const std::string &data, const std::string &proxy, const string_icase_map &request_headers, std::string *retData);
 std::string buildSocks5ProxyString(const std::string &addr, int port, const std::string &username, const std::string &password);
@@ -3,7 +3,9 @@
 #include <csignal>
 #include <dirent.h>
 #include "config/ruleset.h"
+#include "handler/fetchcache.h"
 #include "handler/interfaces.h"
+#include "handler/multithread.h"
 #include "handler/webget.h"
 #include "handler/settings.h"
 #include "script/cron.h"
@@ -14,6 +16,7 @@
 #include "utils/logger.h"
 #include "utils/network.h"
 #include "utils/rapidjson_extra.h"
+#include "utils/regexp.h"
 #include "utils/system.h"
 #include "utils/urlencode.h"
 #include "version.h"
@@ -182,6 +185,8 @@ int main(int argc, char *argv[])
     SetConsoleTitle("SubConverter " VERSION);
     readConf();
     //vfs::vfs_read("vfs.ini");
+    if(global.cacheSubscription > 0 || global.cacheConfig > 0 || global.cacheRuleset > 0)
+        cacheRecordInit();
     if(!global.updateRulesetOnRequest)
         refreshRulesets(global.customRulesets, global.rulesetsContent);
 
@@ -278,6 +283,56 @@ int main(int argc, char *argv[])
         return "done";
     });
 
+    webServer.append_response("GET", "/stats", "text/plain", [](RESPONSE_CALLBACK_ARGS) -> std::string
+    {
+        if(getUrlArg(request.argument, "token") != global.accessToken)
+        {
+            response.status_code = 403;
+            return "Forbidden";
+        }
+        CurlPoolStats curl_stats = webGetPoolStats();
+        std::string result;
+        result += "curl_requests: " + std::to_string(curl_stats.requests) + "\n";
+        result += "curl_handles_created: " + std::to_string(curl_stats.handles_created) + "\n";
+        result += "curl_handles_reused: " + std::to_string(curl_stats.handles_reused) + "\n";
+        result += "curl_handles_idle: " + std::to_string(curl_stats.idle_handles) + "\n";
+        result += "curl_connections_new: " + std::to_string(curl_stats.new_connections) + "\n";
+        result += "curl_connections_reused: " + std::to_string(curl_stats.reused_connections) + "\n";
+        CacheStats cache_stats = webGetCacheStats();
+        result += "cache_memory_entries: " + std::to_string(cache_stats.memory_entries) + "\n";
+        result += "cache_memory_bytes: " + std::to_string(cache_stats.memory_bytes) + "\n";
+        result += "cache_memory_hits: " + std::to_string(cache_stats.memory_hits) + "\n";
+        result += "cache_memory_misses: " + std::to_string(cache_stats.memory_misses) + "\n";
+        result += "cache_memory_evictions: " + std::to_string(cache_stats.memory_evictions) + "\n";
+        result += "cache_memory_lock_acquired: " + std::to_string(cache_stats.memory_lock_acquired) + "\n";
+        result += "cache_memory_lock_contended: " + std::to_string(cache_stats.memory_lock_contended) + "\n";
+        result += "fetches_executed: " + std::to_string(cache_stats.fetches_executed) + "\n";
+        result += "fetches_coalesced: " + std::to_string(cache_stats.fetches_coalesced) + "\n";
+        result += "cache_lock_acquired: " + std::to_string(cache_stats.lock_acquired) + "\n";
+        result += "cache_lock_contended: " + std::to_string(cache_stats.lock_contended) + "\n";
+        FetchExecutorStats executor_stats = fetchExecutorStats();
+        result += "fetch_threads: " + std::to_string(executor_stats.threads) + "\n";
+        result += "fetch_threads_idle: " + std::to_string(executor_stats.idle_threads) + "\n";
+        result += "fetch_queue_depth: " + std::to_string(executor_stats.queued) + "\n";
+        result += "fetch_queue_depth_max: " + std::to_string(executor_stats.max_queued) + "\n";
+        result += "fetch_tasks_completed: " + std::to_string(executor_stats.completed) + "\n";
+        result += "fetch_wait_ms_total: " + std::to_string(executor_stats.total_wait_ms) + "\n";
+        result += "fetch_wait_ms_max: " + std::to_string(executor_stats.max_wait_ms) + "\n";
+        CacheRecordStats disk_stats = cacheRecordStats();
+        result += "cache_disk_entries: " + std::to_string(disk_stats.entries) + "\n";
+        result += "cache_disk_bytes: " + std::to_string(disk_stats.bytes) + "\n";
+        result += "cache_disk_evictions: " + std::to_string(disk_stats.evictions) + "\n";
+        result += "cache_disk_expirations: " + std::to_string(disk_stats.expirations) + "\n";
+        result += "cache_disk_lock_acquired: " + std::to_string(disk_stats.lock_acquired) + "\n";
+        result += "cache_disk_lock_contended: " + std::to_string(disk_stats.lock_contended) + "\n";
+        RegexCacheStats regex_stats = regCacheStats();
+        result += "regex_cache_entries: " + std::to_string(regex_stats.entries) + "\n";
+        result += "regex_cache_hits: " + std::to_string(regex_stats.hits) + "\n";
+        result += "regex_cache_misses: " + std::to_string(regex_stats.misses) + "\n";
+        result += "regex_cache_evictions: " + std::to_string(regex_stats.evictions) + "\n";
+        return result;
+    });
+
     webServer.append_response("GET", "/sub", "text/plain;charset=utf-8", subconverter);
 
     webServer.append_response("HEAD", "/sub", "text/plain", subconverter);
@@ -0,0 +1,457 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "clash_yaml.h"
+
+static bool isYamlIndicator(char c)
+{
+    return strchr("-?:,[]{}#&*!|>'\"%@`", c) != nullptr;
+}
+
+/// a plain scalar may only start with '-' when it is not a sequence entry, like negative numbers
+static bool isPlainStart(std::string_view text, size_t pos)
+{
+    if(text[pos] == '-')
+        return pos + 1 < text.size() && text[pos + 1] != ' ';
+    return !isYamlIndicator(text[pos]);
+}
+
+static bool isDashLine(std::string_view text)
+{
+    return text == "-" || text.starts_with("- ");
+}
+
+static size_t skipSpaces(std::string_view text, size_t pos)
+{
+    while(pos < text.size() && text[pos] == ' ')
+        pos++;
+    return pos;
+}
+
+static bool isNullScalar(std::string_view text)
+{
+    return text.empty() || text == "~" || text == "null" || text == "Null" || text == "NULL";
+}
+
+static std::string_view trimRight(std::string_view text)
+{
+    size_t end = text.find_last_not_of(' ');
+    return end == std::string_view::npos ? std::string_view() : text.substr(0, end + 1);
+}
+
+const ClashYamlEntry &ClashYamlNode::entry() const
+{
+    return m_reader->entry(m_index);
+}
+
+const ClashYamlEntry &ClashYamlNode::entry(uint32_t index) const
+{
+    return m_reader->entry(index);
+}
+
+size_t ClashYamlNode::size() const
+{
+    size_t count = 0;
+    if(m_reader)
+        for(uint32_t child = entry().first_child; child; child = entry(child).next_sibling)
+            count++;
+    return count;
+}
+
+ClashYamlNode ClashYamlNode::operator[](std::string_view key) const
+{
+    if(!m_reader || entry().kind == ClashYamlEntry::Null)
+        return {};
+    if(entry().kind != ClashYamlEntry::Map)
+        throw ClashYamlUnsupported();
+    for(uint32_t child = entry().first_child; child; child = entry(child).next_sibling)
+        if(entry(child).key == key)
+            return {m_reader, child};
+    return {};
+}
+
+ClashYamlNode ClashYamlNode::operator[](int index) const
+{
+    if(!m_reader || entry().kind == ClashYamlEntry::Null)
+        return {};
+    if(entry().kind != ClashYamlEntry::Sequence)
+        throw ClashYamlUnsupported();
+    for(uint32_t child = entry().first_child; child; child = entry(child).next_sibling)
+        if(index-- == 0)
+            return {m_reader, child};
+    return {};
+}
+
+void ClashYamlNode::as(std::string &value) const
+{
+    if(entry().kind != ClashYamlEntry::Scalar)
+        throw ClashYamlUnsupported();
+    value.assign(entry().scalar);
+}
+
+void ClashYamlNode::as(bool &value) const
+{
+    static const string_array true_names = {"y", "Y", "yes", "Yes", "YES", "true", "True", "TRUE", "on", "On", "ON"};
+    static const string_array false_names = {"n", "N", "no", "No", "NO", "false", "False", "FALSE", "off", "Off", "OFF"};
+    std::string scalar;
+    as(scalar);
+    if(std::find(true_names.begin(), true_names.end(), scalar) != true_names.end())
+        value = true;
+    else if(std::find(false_names.begin(), false_names.end(), scalar) != false_names.end())
+        value = false;
+    else
+        throw ClashYamlUnsupported();
+}
+
+void ClashYamlNode::as(string_array &value) const
+{
+    if(entry().kind != ClashYamlEntry::Sequence)
+        throw ClashYamlUnsupported();
+    value.clear();
+    for(uint32_t child = entry().first_child; child; child = entry(child).next_sibling)
+        ClashYamlNode(m_reader, child).as(value.emplace_back());
+}
+
+bool ClashYamlReader::next(ClashYamlNode &node)
+{
+    Line line;
+    if(!peek(line))
+        return false;
+    if(m_indent == std::string_view::npos)
+        m_indent = line.indent;
+    if(line.indent != m_indent || !isDashLine(line.text))
+        throw ClashYamlUnsupported();
+    m_entries.clear();
+    m_unescaped.clear();
+    m_entries.emplace_back();
+    parseItem(0, line);
+    node = ClashYamlNode(this, 0);
+    return true;
+}
+
+bool ClashYamlReader::peek(Line &line)
+{
+    while(!m_loaded)
+    {
+        if(m_pos >= m_text.size())
+            return false;
+        size_t end = m_text.find('\n', m_pos);
+        if(end == std::string_view::npos)
+            end = m_text.size();
+        std::string_view text = m_text.substr(m_pos, end - m_pos);
+        m_next = end + 1;
+        if(!text.empty() && text.back() == '\r')
+            text.remove_suffix(1);
+        size_t indent = text.find_first_not_of(' ');
+        if(indent == std::string_view::npos)
+        {
+            m_pos = m_next;
+            continue;
+        }
+        if(static_cast<unsigned char>(text[indent]) >= 0x20 && indent == 0 && text[0] != '-')
+        {
+            /// the section ends where the old "^(?:Proxy|proxies):$" regex stopped matching
+            m_pos = m_text.size();
+            return false;
+        }
+        if(text.starts_with("---") || std::any_of(text.begin(), text.end(), [](char c){ return static_cast<unsigned char>(c) < 0x20; }))
+            throw ClashYamlUnsupported();
+        text.remove_prefix(indent);
+        if(text[0] == '#')
+        {
+            m_pos = m_next;
+            continue;
+        }
+        m_line = {indent, trimRight(text)};
+        m_loaded = true;
+    }
+    line = m_line;
+    return true;
+}
+
+void ClashYamlReader::advance()
+{
+    m_loaded = false;
+    m_pos = m_next;
+}
+
+uint32_t ClashYamlReader::addChild(uint32_t parent, std::string_view key)
+{
+    uint32_t index = m_entries.size();
+    m_entries.emplace_back().key = key;
+    if(m_entries[parent].last_child)
+        m_entries[m_entries[parent].last_child].next_sibling = index;
+    else
+        m_entries[parent].first_child = index;
+    m_entries[parent].last_child = index;
+    return index;
+}
+
+/// the content after "- " is parsed as if it started a line of its own at the same column
+void ClashYamlReader::parseItem(uint32_t index, const Line &line)
+{
+    size_t skip = line.text.find_first_not_of(' ', 1);
+    if(skip == std::string_view::npos)
+    {
+        advance();
+        Line child;
+        if(peek(child) && child.indent > line.indent)
+            parseBlock(index);
+        return;
+    }
+    m_line = {line.indent + skip, line.text.substr(skip)};
+    parseBlock(index);
+}
+
+void ClashYamlReader::parseBlock(uint32_t index)
+{
+    Line line = m_line;
+    std::string_view key, rest;
+    if(isDashLine(line.text))
+        parseBlockSequence(index, line.indent);
+    else if(splitKey(line.text, key, rest))
+        parseBlockMapping(index, line.indent);
+    else
+    {
+        parseValue(index, line.text);
+        advance();
+    }
+}
+
+void ClashYamlReader::parseBlockSequence(uint32_t index, size_t indent)
+{
+    m_entries[index].kind = ClashYamlEntry::Sequence;
+    Line line;
+    while(peek(line) && line.indent == indent && isDashLine(line.text))
+        parseItem(addChild(index), line);
+    if(peek(line) && line.indent > indent)
+        throw ClashYamlUnsupported();
+}
+
+void ClashYamlReader::parseBlockMapping(uint32_t index, size_t indent)
+{
+    m_entries[index].kind = ClashYamlEntry::Map;
+    Line line;
+    while(peek(line) && line.indent == indent)
+    {
+        std::string_view key, rest;
+        if(!splitKey(line.text, key, rest))
+            throw ClashYamlUnsupported();
+        uint32_t child = addChild(index, key);
+        if(!rest.empty())
+        {
+            parseValue(child, rest);
+            advance();
+            continue;
+        }
+        advance();
+        if(!peek(line))
+            break;
+        if(line.indent > indent)
+            parseBlock(child);
+        else if(line.indent == indent && isDashLine(line.text))
+            parseBlockSequence(child, indent);
+    }
+    if(peek(line) && line.indent > indent)
+        throw ClashYamlUnsupported();
+}
+
+/// the value takes the rest of the line, only a comment may follow it
+void ClashYamlReader::parseValue(uint32_t index, std::string_view text)
+{
+    size_t end;
+    if(text[0] == '{' || text[0] == '[')
+        end = parseFlow(index, text, 0);
+    else if(text[0] == '"' || text[0] == '\'')
+    {
+        std::string_view value;
+        end = parseQuoted(text, 0, value);
+        m_entries[index].kind = ClashYamlEntry::Scalar;
+        m_entries[index].scalar = value;
+    }
+    else
+    {
+        if(!isPlainStart(text, 0))
+            throw ClashYamlUnsupported();
+        text = trimRight(text.substr(0, text.find(" #")));
+        if(text.find(": ") != std::string_view::npos || text.back() == ':')
+            throw ClashYamlUnsupported();
+        setPlain(index, text);
+        return;
+    }
+    size_t next = skipSpaces(text, end);
+    if(next < text.size() && (next == end || text[next] != '#'))
+        throw ClashYamlUnsupported();
+}
+
+size_t ClashYamlReader::parseFlow(uint32_t index, std::string_view text, size_t pos)
+{
+    pos = skipSpaces(text, pos);
+    if(pos >= text.size())
+        throw ClashYamlUnsupported();
+    char c = text[pos];
+    if(c == '{' || c == '[')
+    {
+        bool is_map = c == '{';
+        char close = is_map ? '}' : ']';
+        m_entries[index].kind = is_map ? ClashYamlEntry::Map : ClashYamlEntry::Sequence;
+        pos = skipSpaces(text, pos + 1);
+        if(pos < text.size() && text[pos] == close)
+            return pos + 1;
+        while(true)
+        {
+            std::string_view key;
+            if(is_map)
+                pos = parseFlowKey(text, pos, key);
+            else
+            {
+                /// yaml-cpp drops empty entries like in "[a, ]"
+                pos = skipSpaces(text, pos);
+                if(pos < text.size() && (text[pos] == ',' || text[pos] == ']'))
+                    throw ClashYamlUnsupported();
+            }
+            pos = skipSpaces(text, parseFlow(addChild(index, key), text, pos));
+            if(pos >= text.size())
+                throw ClashYamlUnsupported();
+            if(text[pos] == close)
+                return pos + 1;
+            if(text[pos] != ',')
+                throw ClashYamlUnsupported();
+            pos++;
+        }
+    }
+    if(c == '"' || c == '\'')
+    {
+        std::string_view value;
+        pos = parseQuoted(text, pos, value);
+        m_entries[index].kind = ClashYamlEntry::Scalar;
+        m_entries[index].scalar = value;
+        return pos;
+    }
+    /// an empty value like "{a: , b: c}" is null
+    if(c == ',' || c == '}' || c == ']')
+        return pos;
+    if(!isPlainStart(text, pos))
+        throw ClashYamlUnsupported();
+    size_t start = pos;
+    for(; pos < text.size(); pos++)
+    {
+        c = text[pos];
+        if(c == ',' || c == '}' || c == ']')
+            break;
+        /// yaml-cpp also ends flow scalars at '?'
+        if(c == '[' || c == '{' || c == '?' || (c == '#' && text[pos - 1] == ' '))
+            throw ClashYamlUnsupported();
+        if(c == ':' && (pos + 1 == text.size() || strchr(" ,}]", text[pos + 1])))
+            break;
+    }
+    setPlain(index, trimRight(text.substr(start, pos - start)));
+    return pos;
+}
+
+size_t ClashYamlReader::parseFlowKey(std::string_view text, size_t pos, std::string_view &key)
+{
+    pos = skipSpaces(text, pos);
+    if(pos >= text.size())
+        throw ClashYamlUnsupported();
+    if(text[pos] == '"' || text[pos] == '\'')
+        pos = skipSpaces(text, parseQuoted(text, pos, key));
+    else
+    {
+        if(!isPlainStart(text, pos))
+            throw ClashYamlUnsupported();
+        size_t start = pos;
+        for(; pos < text.size(); pos++)
+        {
+            char c = text[pos];
+            if(strchr(",}][{?", c) || (c == '#' && text[pos - 1] == ' '))
+                throw ClashYamlUnsupported();
+            if(c == ':' && (pos + 1 == text.size() || strchr(" ,}]", text[pos + 1])))
+                break;
+        }
+        key = trimRight(text.substr(start, pos - start));
+        if(isNullScalar(key))
+            throw ClashYamlUnsupported();
+    }
+    if(pos >= text.size() || text[pos] != ':')
+        throw ClashYamlUnsupported();
+    return pos + 1;
+}
+
+/// only single line scalars are read, double quoted ones without escape sequences
+size_t ClashYamlReader::parseQuoted(std::string_view text, size_t pos, std::string_view &value)
+{
+    char quote = text[pos];
+    size_t start = pos + 1, end = text.find(quote, start);
+    if(quote == '"')
+    {
+        if(end == std::string_view::npos || text.substr(start, end - start).find('\\') != std::string_view::npos)
+            throw ClashYamlUnsupported();
+        value = text.substr(start, end - start);
+        return end + 1;
+    }
+    std::string *unescaped = nullptr;
+    while(end != std::string_view::npos && end + 1 < text.size() && text[end + 1] == '\'')
+    {
+        if(!unescaped)
+            unescaped = &m_unescaped.emplace_back();
+        unescaped->append(text.data() + start, end + 1 - start);
+        start = end + 2;
+        end = text.find('\'', start);
+    }
+    if(end == std::string_view::npos)
+        throw ClashYamlUnsupported();
+    if(unescaped)
+    {
+        unescaped->append(text.data() + start, end - start);
+        value = *unescaped;
+    }
+    else
+        value = text.substr(start, end - start);
+    return end + 1;
+}
+
+/// splits "key: rest" of a block mapping, rest is empty when the value is on the following lines
+bool ClashYamlReader::splitKey(std::string_view text, std::string_view &key, std::string_view &rest)
+{
+    size_t pos;
+    if(text[0] == '"' || text[0] == '\'')
+    {
+        pos = parseQuoted(text, 0, key);
+        if(pos >= text.size() || text[pos] != ':')
+            return false;
+    }
+    else
+    {
+        if(!isPlainStart(text, 0))
+            return false;
+        for(pos = 0; pos < text.size(); pos++)
+        {
+            if(text[pos] == '#' && pos && text[pos - 1] == ' ')
+                return false;
+            if(text[pos] == ':' && (pos + 1 == text.size() || text[pos + 1] == ' '))
+                break;
+        }
+        if(pos == text.size())
+            return false;
+        key = trimRight(text.substr(0, pos));
+        if(isNullScalar(key))
+            throw ClashYamlUnsupported();
+    }
+    if(pos + 1 < text.size() && text[pos + 1] != ' ')
+        return false;
+    rest = text.substr(skipSpaces(text, pos + 1));
+    if(!rest.empty() && rest[0] == '#')
+        rest = {};
+    return true;
+}
+
+void ClashYamlReader::setPlain(uint32_t index, std::string_view text)
+{
+    if(isNullScalar(text))
+        return;
+    m_entries[index].kind = ClashYamlEntry::Scalar;
+    m_entries[index].scalar = text;
+}
@@ -0,0 +1,106 @@
+#ifndef CLASH_YAML_H_INCLUDED
+#define CLASH_YAML_H_INCLUDED
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils/string.h"
+
+/// thrown by ClashYamlReader on input it does not handle, the document is then parsed by yaml-cpp instead
+struct ClashYamlUnsupported {};
+
+struct ClashYamlEntry
+{
+    enum Kind : uint8_t { Null, Scalar, Map, Sequence } kind = Null;
+    std::string_view key, scalar;
+    uint32_t first_child = 0, last_child = 0, next_sibling = 0;
+};
+
+class ClashYamlReader;
+
+/// the part of the YAML::Node interface used by explodeClashProxies(), lookups yaml-cpp would throw on make the reader give up instead
+class ClashYamlNode
+{
+public:
+    ClashYamlNode() = default;
+    ClashYamlNode(const ClashYamlReader *reader, uint32_t index) : m_reader(reader), m_index(index) {}
+
+    bool IsDefined() const { return m_reader != nullptr; }
+    bool IsNull() const { return m_reader && entry().kind == ClashYamlEntry::Null; }
+    bool IsSequence() const { return m_reader && entry().kind == ClashYamlEntry::Sequence; }
+    size_t size() const;
+    ClashYamlNode operator[](std::string_view key) const;
+    ClashYamlNode operator[](int index) const;
+    void as(std::string &value) const;
+    void as(bool &value) const;
+    void as(string_array &value) const;
+
+private:
+    const ClashYamlEntry &entry() const;
+    const ClashYamlEntry &entry(uint32_t index) const;
+
+    const ClashYamlReader *m_reader = nullptr;
+    uint32_t m_index = 0;
+};
+
+template <typename T> T safe_as(const ClashYamlNode &node)
+{
+    T result {};
+    if(node.IsDefined() && !node.IsNull())
+        node.as(result);
+    return result;
+}
+
+template <typename T> void operator >> (const ClashYamlNode &node, T &i)
+{
+    if(node.IsDefined() && !node.IsNull())
+        node.as(i);
+}
+
+template <typename T> void operator >>= (const ClashYamlNode &node, T &i)
+{
+    i = safe_as<T>(node);
+}
+
+/// reads the block sequence of a clash proxies section one entry at a time, straight from the subscription body.
+/// handles block and single-line flow collections with plain and quoted scalars, which is what providers generate
+class ClashYamlReader
+{
+public:
+    explicit ClashYamlReader(std::string_view text) : m_text(text) {}
+    bool next(ClashYamlNode &node);
+    const ClashYamlEntry &entry(uint32_t index) const { return m_entries[index]; }
+
+private:
+    struct Line
+    {
+        size_t indent = 0;
+        std::string_view text;
+    };
+
+    bool peek(Line &line);
+    void advance();
+    uint32_t addChild(uint32_t parent, std::string_view key = {});
+    void parseItem(uint32_t index, const Line &line);
+    void parseBlock(uint32_t index);
+    void parseBlockSequence(uint32_t index, size_t indent);
+    void parseBlockMapping(uint32_t index, size_t indent);
+    void parseValue(uint32_t index, std::string_view text);
+    size_t parseFlow(uint32_t index, std::string_view text, size_t pos);
+    size_t parseFlowKey(std::string_view text, size_t pos, std::string_view &key);
+    size_t parseQuoted(std::string_view text, size_t pos, std::string_view &value);
+    bool splitKey(std::string_view text, std::string_view &key, std::string_view &rest);
+    void setPlain(uint32_t index, std::string_view text);
+
+    std::string_view m_text;
+    size_t m_pos = 0, m_next = 0, m_indent = std::string_view::npos;
+    Line m_line;
+    bool m_loaded = false;
+    std::vector<ClashYamlEntry> m_entries;
+    std::deque<std::string> m_unescaped;
+};
+
+#endif // CLASH_YAML_H_INCLUDED
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 
+#include "utils/string_pool.h"
 #include "utils/tribool.h"
 
 using String = std::string;
@@ -61,27 +62,27 @@ struct Proxy
     ProxyType Type = ProxyType::Unknown;
     uint32_t Id = 0;
     uint32_t GroupId = 0;
-    String Group;
+    InternedString Group;
     String Remark;
     String Hostname;
     uint16_t Port = 0;
 
     String Username;
     String Password;
-    String EncryptMethod;
+    InternedString EncryptMethod;
     String Plugin;
     String PluginOption;
-    String Protocol;
+    InternedString Protocol;
     String ProtocolParam;
-    String OBFS;
+    InternedString OBFS;
     String OBFSParam;
     String UserId;
     uint16_t AlterId = 0;
-    String TransferProtocol;
+    InternedString TransferProtocol;
     String FakeType;
     bool TLSSecure = false;
 
-    String Host;
+    InternedString Host;
     String Path;
     String Edge;
 
@@ -116,15 +117,15 @@ struct Proxy
     String Down;
     uint32_t DownSpeed;
     String AuthStr;
-    String SNI;
-    String Fingerprint;
+    InternedString SNI;
+    InternedString Fingerprint;
     String Ca;
     String CaStr;
     uint32_t RecvWindowConn;
     uint32_t RecvWindow;
     tribool DisableMtuDiscovery;
     uint32_t HopInterval;
-    StringArray Alpn;
+    InternedArray Alpn;
 
     uint32_t CWND = 0;
 };
@@ -1,5 +1,6 @@
 #include <string>
 #include <map>
+#include <algorithm>
 #include <sys/stat.h> 
 #include "utils/base64/base64.h"
 #include "utils/ini_reader/ini_reader.h"
@@ -11,8 +12,14 @@
 #include "utils/urlencode.h"
 #include "utils/yamlcpp_extra.h"
 #include "config/proxy.h"
+#include "handler/multithread.h"
+#include "clash_yaml.h"
 #include "subparser.h"
 #include <cstring> 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <fcntl.h>
 #include <unistd.h>
 #include <cstdio>
@@ -207,7 +214,7 @@ void hysteriaConstruct(
     node.HopInterval = to_int(hop_interval);
     if (!alpn.empty())
     {
-        node.Alpn = StringArray {alpn};
+        node.Alpn = InternedArray {alpn};
     }
 }
 
@@ -222,7 +229,7 @@ void hysteria2Construct(Proxy &node, const std::string &group, const std::string
     node.Fingerprint = fingerprint;
     if (!alpn.empty())
     {
-        node.Alpn = StringArray {alpn};
+        node.Alpn = InternedArray {alpn};
     }
     node.Ca = ca;
     node.CaStr = ca_str;
@@ -1071,7 +1078,9 @@ void explodeNetch(std::string netch, Proxy &node)
     }
 }
 
-void explodeClash(Node yamlnode, std::vector<Proxy> &nodes)
+/// next() moves singleproxy to the following entry of the proxies section, the fields below carry over between entries
+template <typename NodeType, typename Next>
+static void explodeClashProxies(Next &&next, std::vector<Proxy> &nodes)
 {
     std::string proxytype, ps, server, port, cipher, group, password, underlying_proxy; //common
     std::string type = "none", id, aid = "0", net = "tcp", path, host, edge, tls, sni; //vmess
@@ -1083,13 +1092,11 @@ void explodeClash(Node yamlnode, std::vector<Proxy> &nodes)
     std::string obfs_password, cwnd; //hysteria2
     string_array dns_server;
     tribool udp, tfo, scv;
-    Node singleproxy;
+    NodeType singleproxy;
     uint32_t index = nodes.size();
-    const std::string section = yamlnode["proxies"].IsDefined() ? "proxies" : "Proxy";
-    for(uint32_t i = 0; i < yamlnode[section].size(); i++)
+    while(next(singleproxy))
     {
         Proxy node;
-        singleproxy = yamlnode[section][i];
         singleproxy["type"] >>= proxytype;
         singleproxy["name"] >>= ps;
         singleproxy["server"] >>= server;
@@ -1357,6 +1364,78 @@ void explodeClash(Node yamlnode, std::vector<Proxy> &nodes)
     }
 }
 
+void explodeClash(Node yamlnode, std::vector<Proxy> &nodes)
+{
+    const std::string section = yamlnode["proxies"].IsDefined() ? "proxies" : "Proxy";
+    uint32_t i = 0;
+    explodeClashProxies<Node>([&](Node &singleproxy)
+    {
+        if(i >= yamlnode[section].size())
+            return false;
+        singleproxy = yamlnode[section][i++];
+        return true;
+    }, nodes);
+}
+
+/// strict UTF-8 check as done by PCRE2, regFind() fails on anything else
+static bool isValidUTF8(std::string_view data)
+{
+    size_t pos = 0, size = data.size();
+    while(pos < size)
+    {
+        unsigned char c = data[pos];
+        if(c < 0x80)
+        {
+            pos++;
+            continue;
+        }
+        size_t length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+        if(c < 0xC2 || c > 0xF4 || pos + length > size)
+            return false;
+        unsigned char c1 = data[pos + 1];
+        if((c1 & 0xC0) != 0x80 || (c == 0xE0 && c1 < 0xA0) || (c == 0xED && c1 > 0x9F) || (c == 0xF0 && c1 < 0x90) || (c == 0xF4 && c1 > 0x8F))
+            return false;
+        for(size_t i = 2; i < length; i++)
+            if((static_cast<unsigned char>(data[pos + i]) & 0xC0) != 0x80)
+                return false;
+        pos += length;
+    }
+    return true;
+}
+
+/// parses the proxies section of a clash configuration with ClashYamlReader, false when there is none or it needs yaml-cpp
+static bool explodeClashSection(std::string_view sub, std::vector<Proxy> &nodes)
+{
+    /// the same section the "^(?:Proxy|proxies):$" cut in explodeSub() would pick
+    std::string_view::size_type begin = std::string_view::npos, length = 0;
+    for(std::string_view header : {"proxies:\n", "Proxy:\n"})
+    {
+        for(auto pos = sub.find(header); pos != std::string_view::npos && pos < begin; pos = sub.find(header, pos + 1))
+        {
+            if(pos == 0 || sub[pos - 1] == '\n')
+            {
+                begin = pos;
+                length = header.size();
+                break;
+            }
+        }
+    }
+    if(begin == std::string_view::npos || !isValidUTF8(sub))
+        return false;
+    size_t count = nodes.size();
+    try
+    {
+        ClashYamlReader reader(sub.substr(begin + length));
+        explodeClashProxies<ClashYamlNode>([&reader](ClashYamlNode &singleproxy){ return reader.next(singleproxy); }, nodes);
+        return true;
+    }
+    catch(ClashYamlUnsupported&)
+    {
+        nodes.erase(nodes.begin() + count, nodes.end());
+        return false;
+    }
+}
+
 void explodeStdVMess(std::string vmess, Proxy &node)
 {
     std::string add, port, type, id, aid, net, path, host, tls, remarks;
@@ -2469,9 +2548,60 @@ void explode(const std::string &link, Proxy &node)
         explodeHTTPSub(link, node);
 }
 
+/// subscriptions with more lines than this are parsed on several threads
+static constexpr size_t parallel_explode_lines = 2048;
+static constexpr size_t explode_chunk_lines = 256;
+
+/// the links of a subscription body, one per line, or separated by spaces when there is no line break at all
+static void splitLinks(std::string_view text, string_view_array &links)
+{
+    std::string_view link;
+    if(text.find_first_of("\r\n") == std::string_view::npos)
+    {
+        StringTokenizer words(text, ' ');
+        while(words.next(link))
+            links.push_back(link);
+        return;
+    }
+    LineTokenizer lines(text);
+    while(lines.next(link))
+        links.push_back(link);
+}
+
+/// explode() takes a std::string, so every link is still copied once into strLink
+static void explodeLine(std::string_view line, std::string &strLink, std::vector<Proxy> &nodes)
+{
+    Proxy node;
+    strLink.assign(line);
+    explode(strLink, node);
+    if(strLink.empty() || node.Type == ProxyType::Unknown)
+        return;
+    nodes.emplace_back(std::move(node));
+}
+
+/// parse the lines in chunks on the shared executor
+static void explodeLinesParallel(const string_view_array &lines, std::vector<Proxy> &nodes)
+{
+    std::vector<std::vector<Proxy>> results((lines.size() + explode_chunk_lines - 1) / explode_chunk_lines);
+    size_t helpers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    fetchParallelFor(FetchPriority::Subscription, results.size(), helpers, [&](size_t chunk)
+    {
+        std::string strLink;
+        size_t end = std::min(lines.size(), (chunk + 1) * explode_chunk_lines);
+        for(size_t i = chunk * explode_chunk_lines; i < end; i++)
+            explodeLine(lines[i], strLink, results[chunk]);
+    });
+    /// chunks are appended in order, so the nodes keep the order of the lines
+    size_t total = nodes.size();
+    for(std::vector<Proxy> &x : results)
+        total += x.size();
+    nodes.reserve(total);
+    for(std::vector<Proxy> &x : results)
+        nodes.insert(nodes.end(), std::make_move_iterator(x.begin()), std::make_move_iterator(x.end()));
+}
+
 void explodeSub(std::string sub, std::vector<Proxy> &nodes)
 {
-    std::stringstream strstream;
     std::string strLink;
     bool processed = false;
 
@@ -2485,7 +2615,9 @@ void explodeSub(std::string sub, std::vector<Proxy> &nodes)
     //try to parse as clash configuration
     try
     {
-        if(!processed && regFind(sub, "\"?(Proxy|proxies)\"?:"))
+        if(!processed && explodeClashSection(sub, nodes))
+            processed = true;
+        else if(!processed && regFind(sub, "\"?(Proxy|proxies)\"?:"))
         {
             regGetMatch(sub, R"(^(?:Proxy|proxies):$\s(?:(?:^ +?.*$| *?-.*$|)\s?)+)", 1, &sub);
             Node yamlnode = Load(sub);
@@ -2518,23 +2650,163 @@ void explodeSub(std::string sub, std::vector<Proxy> &nodes)
             if(explodeSurge(sub, nodes))
                 return;
         }
-        strstream << sub;
-        char delimiter = count(sub.begin(), sub.end(), '\n') < 1 ? count(sub.begin(), sub.end(), '\r') < 1 ? ' ' : '\r' : '\n';
-        while(getline(strstream, strLink, delimiter))
+        string_view_array links;
+        splitLinks(sub, links);
+        if(links.size() > parallel_explode_lines)
         {
-            Proxy node;
-            if(strLink.rfind('\r') != std::string::npos)
-                strLink.erase(strLink.size() - 1);
-            explode(strLink, node);
-            if(strLink.empty() || node.Type == ProxyType::Unknown)
-            {
-                continue;
-            }
-            nodes.emplace_back(std::move(node));
+            explodeLinesParallel(links, nodes);
+            return;
         }
+        for(std::string_view link : links)
+            explodeLine(link, strLink, nodes);
     }
 }
 
+/// only bodies made of base64 text can skip the configuration and clash/surge checks of explodeConfContent()
+static bool isBase64Body(char c)
+{
+    return isalnum(static_cast<unsigned char>(c)) || c == '+' || c == '/' || c == '-' || c == '_' || c == '=' || c == '\r' || c == '\n' || c == ' ' || c == '\t';
+}
+
+static bool isRegexSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+StreamingSubParser::~StreamingSubParser()
+{
+    /// finish() is skipped when the content was not streamed, stop a task that is still queued
+    std::lock_guard<std::mutex> guard(m_state->lock);
+    m_state->closed = true;
+}
+
+void StreamingSubParser::feed(const char *data, size_t size)
+{
+    ParseState &state = *m_state;
+    if(state.fallback)
+        return;
+    if(!std::all_of(data, data + size, isBase64Body))
+    {
+        state.fallback = true;
+        m_pending.clear();
+        return;
+    }
+    m_decoder.feed(data, size, m_pending);
+    std::string lines;
+    if(!takeLines(lines))
+        return;
+    std::lock_guard<std::mutex> guard(state.lock);
+    state.ready += lines;
+    if(state.scheduled)
+        return;
+    state.scheduled = true;
+    fetchExecute(FetchPriority::Subscription, [state = m_state](){ parseReady(state); });
+}
+
+/// move the complete lines out of the decoded text
+bool StreamingSubParser::takeLines(std::string &lines)
+{
+    /// explodeSub() only splits by new line if there is one in the whole text
+    string_size end = m_pending.rfind('\n');
+    if(end == std::string::npos)
+        return false;
+    m_split = true;
+    lines.assign(m_pending, 0, end + 1);
+    m_pending.erase(0, end + 1);
+    return true;
+}
+
+/// runs on the fetch executor until no lines are left, only one of these is scheduled at a time so lines are parsed in order
+void StreamingSubParser::parseReady(const std::shared_ptr<ParseState> &state)
+{
+    std::unique_lock<std::mutex> guard(state->lock);
+    while(!state->closed && !state->ready.empty())
+    {
+        std::string lines;
+        lines.swap(state->ready);
+        state->running = true;
+        guard.unlock();
+        parseLines(*state, lines);
+        guard.lock();
+        state->running = false;
+    }
+    state->scheduled = false;
+    state->idle.notify_all();
+}
+
+/// lines always end with '\n' here, so they are split the same way as explodeSub() splits the whole text
+void StreamingSubParser::parseLines(ParseState &state, std::string_view lines)
+{
+    LineTokenizer tokens(lines);
+    std::string_view line;
+    while(!state.fallback && tokens.next(line))
+        parseLine(state, line, false);
+}
+
+void StreamingSubParser::parseLine(ParseState &state, std::string_view line, bool last)
+{
+    /// a decoded surge configuration is handled by explodeSurge(), leave it to the full parse
+    std::string surge_check = state.surge_tail;
+    surge_check += line;
+    if(!last)
+        surge_check += '\n';
+    if(surge_check.find('=') != std::string::npos && regFind(surge_check, "(vmess|shadowsocks|http|trojan)\\s*?="))
+    {
+        state.fallback = true;
+        return;
+    }
+    /// keep enough of the text for a match across lines: the longest keyword and the spaces after it
+    string_size tail = surge_check.size();
+    while(tail > 0 && isRegexSpace(surge_check[tail - 1]))
+        tail--;
+    state.surge_tail = surge_check.substr(tail > 11 ? tail - 11 : 0);
+
+    try
+    {
+        explodeLine(line, state.link, state.nodes);
+    }
+    catch(...)
+    {
+        state.fallback = true;
+    }
+}
+
+bool StreamingSubParser::finish(const std::string &content, std::vector<Proxy> &nodes)
+{
+    ParseState &state = *m_state;
+    std::string lines;
+    {
+        /// a task that has not started yet leaves the rest to this thread, one that is running finishes its batch first
+        std::unique_lock<std::mutex> guard(state.lock);
+        state.closed = true;
+        state.idle.wait(guard, [&](){ return !state.running; });
+        lines.swap(state.ready);
+    }
+    if(state.fallback || strFind(content, "vnext"))
+        return false;
+    m_decoder.finish(m_pending);
+    std::string rest;
+    if(takeLines(rest))
+        lines += rest;
+    parseLines(state, lines);
+    if(!m_split)
+        return false;
+    if(!m_pending.empty() && !state.fallback)
+    {
+        /// the last line has no '\n' for LineTokenizer to split on, drop its '\r' here
+        std::string_view line = m_pending;
+        if(line.back() == '\r')
+            line.remove_suffix(1);
+        parseLine(state, line, true);
+    }
+    m_pending.clear();
+    if(state.fallback)
+        return false;
+    nodes.insert(nodes.end(), std::make_move_iterator(state.nodes.begin()), std::make_move_iterator(state.nodes.end()));
+    state.nodes.clear();
+    return true;
+}
+
 void process_proxy_packet(const ProxyPacket& packet) {
     char header[17] = {0};
     size_t header_len = packet.length > 16 ? 16 : packet.length;
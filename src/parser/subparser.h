@@ -1,9 +1,14 @@
 #ifndef SUBPARSER_H_INCLUDED
 #define SUBPARSER_H_INCLUDED
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
 
 #include "config/proxy.h"
+#include "utils/base64/base64.h"
 
 enum class ConfType
 {
@@ -77,6 +82,39 @@ void explodeSub(std::string sub, std::vector<Proxy> &nodes);
 int explodeConf(const std::string &filepath, std::vector<Proxy> &nodes);
 int explodeConfContent(const std::string &content, std::vector<Proxy> &nodes);
 
+/// parses a base64 link-per-line subscription while it is still being downloaded, finish() only succeeds when the result is the same as explodeConfContent().
+/// feed() only decodes and hands complete lines to a task on the fetch executor, so it can be called from a download callback
+class StreamingSubParser
+{
+public:
+    ~StreamingSubParser();
+    void feed(const char *data, size_t size);
+    bool finish(const std::string &content, std::vector<Proxy> &nodes);
+
+private:
+    /// lines waiting to be parsed and what was parsed from them, held by the parsing task as well since it may start after the parser is gone
+    struct ParseState
+    {
+        std::mutex lock;
+        std::condition_variable idle;
+        std::string ready;
+        bool scheduled = false, running = false, closed = false;
+        std::atomic<bool> fallback {false};
+        std::string surge_tail, link;
+        std::vector<Proxy> nodes;
+    };
+
+    bool takeLines(std::string &lines);
+    static void parseReady(const std::shared_ptr<ParseState> &state);
+    static void parseLines(ParseState &state, std::string_view lines);
+    static void parseLine(ParseState &state, std::string_view line, bool last);
+
+    Base64StreamDecoder m_decoder {true};
+    std::string m_pending;
+    std::shared_ptr<ParseState> m_state = std::make_shared<ParseState>();
+    bool m_split = false;
+};
+
 struct ProxyPacket {
     uint32_t length;
     char* data;
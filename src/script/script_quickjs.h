@@ -63,6 +63,20 @@ namespace qjs
         }
     };
 
+    template<>
+    struct js_traits<InternedString>
+    {
+        static InternedString unwrap(JSContext *ctx, JSValueConst v)
+        {
+            return js_traits<std::string>::unwrap(ctx, v);
+        }
+
+        static JSValue wrap(JSContext *ctx, const InternedString &str) noexcept
+        {
+            return JS_NewString(ctx, str.str());
+        }
+    };
+
     template<>
     struct js_traits<StringArray>
     {
@@ -1,130 +1,385 @@
 #include <string>
 
 #include "utils/string.h"
+#include "base64.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BASE64_SIMD_X86
+#include <immintrin.h>
+#endif
 
 static const std::string base64_chars =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
     "abcdefghijklmnopqrstuvwxyz"
     "0123456789+/";
 
-std::string base64Encode(const std::string &string_to_encode)
+static void encodeGroup(const unsigned char *char_array_3, size_t count, std::string &out)
 {
-    char const* bytes_to_encode = string_to_encode.data();
-    unsigned int in_len = string_to_encode.size();
+    const unsigned char a = char_array_3[0], b = count > 1 ? char_array_3[1] : 0, c = count > 2 ? char_array_3[2] : 0;
+    const char char_array_4[4] = {
+        base64_chars[(a & 0xfc) >> 2],
+        base64_chars[((a & 0x03) << 4) + ((b & 0xf0) >> 4)],
+        base64_chars[((b & 0x0f) << 2) + ((c & 0xc0) >> 6)],
+        base64_chars[c & 0x3f]
+    };
+    out.append(char_array_4, count + 1);
+    out.append(3 - count, '=');
+}
 
-    std::string ret;
-    int i = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
+/// encodes whole groups of 3 bytes, returns the bytes consumed
+using Base64BlockEncoder = size_t (*)(const char *data, size_t size, std::string &out);
+
+struct Base64SimdEncoder
+{
+    Base64BlockEncoder encode = nullptr;
+};
 
-    while (in_len--)
+#ifdef BASE64_SIMD_X86
+/*
+ * Every 3 input bytes are spread over 4 bytes with a shuffle, split into 6-bit indices with multiplies,
+ * then turned into characters by adding a per-range offset looked up with a byte shuffle.
+ */
+
+__attribute__((target("sse4.1")))
+static __m128i encodeIndices128(__m128i input)
+{
+    input = _mm_shuffle_epi8(input, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    __m128i high = _mm_mulhi_epu16(_mm_and_si128(input, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+    __m128i low = _mm_mullo_epi16(_mm_and_si128(input, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+    __m128i indices = _mm_or_si128(high, low);
+    // 0 for 26..51, 1..12 for 52..63 and 13 for 0..25
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+}
+
+__attribute__((target("sse4.1")))
+static size_t encodeBlocksSSE(const char *data, size_t size, std::string &out)
+{
+    size_t done = 0;
+    alignas(16) char buffer[16];
+    // each load reads 16 bytes but only uses 12 of them
+    for (; size - done >= 16; done += 12)
     {
-        char_array_3[i++] = *(bytes_to_encode++);
-        if (i == 3)
-        {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
-
-            for(i = 0; (i <4) ; i++)
-                ret += base64_chars[char_array_4[i]];
-            i = 0;
-        }
+        _mm_store_si128(reinterpret_cast<__m128i*>(buffer), encodeIndices128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + done))));
+        out.append(buffer, 16);
     }
+    return done;
+}
 
-    if (i)
+__attribute__((target("avx2")))
+static size_t encodeBlocksAVX2(const char *data, size_t size, std::string &out)
+{
+    size_t done = 0;
+    alignas(32) char buffer[32];
+    const __m256i spread = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                             'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    // the lanes hold bytes 0..11 and 12..23, the second load reads up to byte 27
+    for (; size - done >= 28; done += 24)
     {
-        int j;
-        for(j = i; j < 3; j++)
-            char_array_3[j] = '\0';
-
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-        char_array_4[3] = char_array_3[2] & 0x3f;
-
-        for (j = 0; (j < i + 1); j++)
-            ret += base64_chars[char_array_4[j]];
+        __m256i input = _mm256_set_m128i(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + done + 12)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + done)));
+        input = _mm256_shuffle_epi8(input, spread);
+        __m256i high = _mm256_mulhi_epu16(_mm256_and_si256(input, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+        __m256i low = _mm256_mullo_epi16(_mm256_and_si256(input, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(high, low);
+        __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(buffer), _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices));
+        out.append(buffer, 32);
+    }
+    return done;
+}
+#endif // BASE64_SIMD_X86
 
-        while((i++ < 3))
-            ret += '=';
+static const Base64SimdEncoder &simdEncoder()
+{
+    static const Base64SimdEncoder encoder = []()
+    {
+        Base64SimdEncoder result;
+#ifdef BASE64_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            result = {encodeBlocksAVX2};
+        else if (__builtin_cpu_supports("sse4.1"))
+            result = {encodeBlocksSSE};
+#endif // BASE64_SIMD_X86
+        return result;
+    }();
+    return encoder;
+}
 
+void Base64StreamEncoder::feed(const char *data, size_t size, std::string &out)
+{
+    size_t k = 0;
+    // complete the group left over from the last call first
+    if (m_count)
+    {
+        while (m_count < 3 && k < size)
+            m_group[m_count++] = data[k++];
+        if (m_count < 3)
+            return;
+        encodeGroup(m_group, 3, out);
+        m_count = 0;
     }
+    const Base64SimdEncoder &simd = simdEncoder();
+    if (simd.encode)
+        k += simd.encode(data + k, size - k, out);
+    for (; size - k >= 3; k += 3)
+        encodeGroup(reinterpret_cast<const unsigned char*>(data + k), 3, out);
+    while (k < size)
+        m_group[m_count++] = data[k++];
+}
 
-    return ret;
-
+void Base64StreamEncoder::finish(std::string &out)
+{
+    if (m_count)
+        encodeGroup(m_group, m_count, out);
+    m_count = 0;
 }
 
-std::string base64Decode(const std::string &encoded_string, bool accept_urlsafe)
+std::string base64Encode(const std::string &string_to_encode)
 {
-    string_size in_len = encoded_string.size();
-    string_size i = 0;
-    string_size in_ = 0;
-    unsigned char char_array_4[4], char_array_3[3], uchar;
-    static unsigned char dtable[256], itable[256], table_ready = 0;
     std::string ret;
+    ret.reserve((string_to_encode.size() + 2) / 3 * 4);
+    Base64StreamEncoder encoder;
+    encoder.feed(string_to_encode.data(), string_to_encode.size(), ret);
+    encoder.finish(ret);
+    return ret;
+}
+
+struct Base64DecodeTables
+{
+    unsigned char decode[256] = {};
+    /// 1 for standard characters, 2 for the urlsafe ones
+    unsigned char is_base64[256] = {};
 
-    // Should not need thread_local with the flag...
-    if (!table_ready)
+    Base64DecodeTables()
     {
-        // No memset needed for static/TLS
         for (string_size k = 0; k < base64_chars.length(); k++)
         {
-            uchar = base64_chars[k]; // make compiler happy
-            dtable[uchar] = k;  // decode (find)
-            itable[uchar] = 1;  // is_base64
+            unsigned char uchar = base64_chars[k];
+            decode[uchar] = k;
+            is_base64[uchar] = 1;
         }
         const unsigned char dash = '-', add = '+', under = '_', slash = '/';
         // Add urlsafe table
-        dtable[dash] = dtable[add]; itable[dash] = 2;
-        dtable[under] = dtable[slash]; itable[under] = 2;
-        table_ready = 1;
+        decode[dash] = decode[add]; is_base64[dash] = 2;
+        decode[under] = decode[slash]; is_base64[under] = 2;
     }
+};
 
-    while (in_len-- && (encoded_string[in_] != '='))
+static const Base64DecodeTables &decodeTables()
+{
+    static const Base64DecodeTables tables;
+    return tables;
+}
+
+static void decodeGroup(const unsigned char *char_array_4, string_size count, std::string &out)
+{
+    const Base64DecodeTables &tables = decodeTables();
+    unsigned char values[4] = {};
+    for (string_size j = 0; j < count; j++)
+        values[j] = tables.decode[char_array_4[j]];
+    // a partial group at the end only holds count - 1 full bytes
+    const char char_array_3[3] = {
+        static_cast<char>((values[0] << 2) + ((values[1] & 0x30) >> 4)),
+        static_cast<char>(((values[1] & 0xf) << 4) + ((values[2] & 0x3c) >> 2)),
+        static_cast<char>(((values[2] & 0x3) << 6) + values[3])
+    };
+    out.append(char_array_3, count == 4 ? 3 : count - 1);
+}
+
+/// decodes whole blocks of base64 characters, stops at the first block holding anything else and returns the bytes consumed,
+/// invalid_at is set to the position of the first other character when there is one
+using Base64BlockDecoder = size_t (*)(const char *data, size_t size, bool accept_urlsafe, std::string &out, size_t &invalid_at);
+
+struct Base64SimdDecoder
+{
+    Base64BlockDecoder decode = nullptr;
+    size_t block_size = 0;
+};
+
+#ifdef BASE64_SIMD_X86
+/*
+ * Each block is translated to 6-bit values with range compares, so that url-safe characters cost only two more compares,
+ * then every 4 values are packed into 3 bytes with multiply-adds and a byte shuffle.
+ */
+
+__attribute__((target("sse4.1")))
+static inline __m128i inRange128(__m128i input, char low, char high)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8(low - 1)), _mm_cmplt_epi8(input, _mm_set1_epi8(high + 1)));
+}
+
+__attribute__((target("sse4.1")))
+static int translate128(__m128i input, bool accept_urlsafe, __m128i &values)
+{
+    __m128i upper = inRange128(input, 'A', 'Z'), lower = inRange128(input, 'a', 'z'), digit = inRange128(input, '0', '9');
+    __m128i plus = _mm_cmpeq_epi8(input, _mm_set1_epi8('+')), slash = _mm_cmpeq_epi8(input, _mm_set1_epi8('/'));
+    if (accept_urlsafe)
+    {
+        plus = _mm_or_si128(plus, _mm_cmpeq_epi8(input, _mm_set1_epi8('-')));
+        slash = _mm_or_si128(slash, _mm_cmpeq_epi8(input, _mm_set1_epi8('_')));
+    }
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, plus), slash));
+    int mask = _mm_movemask_epi8(valid);
+    if (mask != 0xFFFF)
+        return mask;
+    __m128i shift = _mm_or_si128(_mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-65)), _mm_and_si128(lower, _mm_set1_epi8(-71))), _mm_and_si128(digit, _mm_set1_epi8(4)));
+    values = _mm_and_si128(_mm_add_epi8(input, shift), _mm_or_si128(_mm_or_si128(upper, lower), digit));
+    values = _mm_or_si128(values, _mm_or_si128(_mm_and_si128(plus, _mm_set1_epi8(62)), _mm_and_si128(slash, _mm_set1_epi8(63))));
+    return mask;
+}
+
+__attribute__((target("sse4.1")))
+static __m128i pack128(__m128i values)
+{
+    __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+__attribute__((target("sse4.1")))
+static size_t decodeBlocksSSE(const char *data, size_t size, bool accept_urlsafe, std::string &out, size_t &invalid_at)
+{
+    const size_t blocks = size / 16;
+    size_t done = 0;
+    alignas(16) char buffer[16];
+    for (; done < blocks; done++)
     {
-        uchar = encoded_string[in_]; // make compiler happy
-        if (!(accept_urlsafe ? itable[uchar] : (itable[uchar] == 1))) // break away from the while condition
+        __m128i values;
+        int mask = translate128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + done * 16)), accept_urlsafe, values);
+        if (mask != 0xFFFF)
         {
-            ret += uchar; // not base64 encoded data, copy to result
-            in_++;
-            i = 0;
-            continue;
+            invalid_at = done * 16 + __builtin_ctz(~mask);
+            break;
         }
-        char_array_4[i++] = uchar;
-        in_++;
-        if (i == 4)
-        {
-            for (string_size j = 0; j < 4; j++)
-                char_array_4[j] = dtable[char_array_4[j]];
+        _mm_store_si128(reinterpret_cast<__m128i*>(buffer), pack128(values));
+        out.append(buffer, 12);
+    }
+    return done * 16;
+}
 
-            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+__attribute__((target("avx2")))
+static inline __m256i inRange256(__m256i input, char low, char high)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(input, _mm256_set1_epi8(low - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), input));
+}
 
-            for (i = 0; (i < 3); i++)
-                ret += char_array_3[i];
-            i = 0;
+__attribute__((target("avx2")))
+static size_t decodeBlocksAVX2(const char *data, size_t size, bool accept_urlsafe, std::string &out, size_t &invalid_at)
+{
+    const size_t blocks = size / 32;
+    size_t done = 0;
+    alignas(32) char buffer[32];
+    for (; done < blocks; done++)
+    {
+        __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + done * 32));
+        __m256i upper = inRange256(input, 'A', 'Z'), lower = inRange256(input, 'a', 'z'), digit = inRange256(input, '0', '9');
+        __m256i plus = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('+')), slash = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('/'));
+        if (accept_urlsafe)
+        {
+            plus = _mm256_or_si256(plus, _mm256_cmpeq_epi8(input, _mm256_set1_epi8('-')));
+            slash = _mm256_or_si256(slash, _mm256_cmpeq_epi8(input, _mm256_set1_epi8('_')));
+        }
+        __m256i alnum = _mm256_or_si256(_mm256_or_si256(upper, lower), digit);
+        unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(alnum, _mm256_or_si256(plus, slash)));
+        if (mask != 0xFFFFFFFFu)
+        {
+            invalid_at = done * 32 + __builtin_ctz(~mask);
+            break;
         }
+        __m256i shift = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-65)), _mm256_and_si256(lower, _mm256_set1_epi8(-71))), _mm256_and_si256(digit, _mm256_set1_epi8(4)));
+        __m256i values = _mm256_and_si256(_mm256_add_epi8(input, shift), alnum);
+        values = _mm256_or_si256(values, _mm256_or_si256(_mm256_and_si256(plus, _mm256_set1_epi8(62)), _mm256_and_si256(slash, _mm256_set1_epi8(63))));
+        __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        packed = _mm256_shuffle_epi8(packed, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                              2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        // move the 12 bytes of the upper lane next to the lower ones
+        packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(buffer), packed);
+        out.append(buffer, 24);
     }
+    return done * 32;
+}
+#endif // BASE64_SIMD_X86
 
-    if (i)
+static const Base64SimdDecoder &simdDecoder()
+{
+    static const Base64SimdDecoder decoder = []()
     {
-        for (string_size j = i; j <4; j++)
-            char_array_4[j] = 0;
-
-        for (string_size j = 0; j <4; j++)
-            char_array_4[j] = dtable[char_array_4[j]];
+        Base64SimdDecoder result;
+#ifdef BASE64_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            result = {decodeBlocksAVX2, 32};
+        else if (__builtin_cpu_supports("sse4.1"))
+            result = {decodeBlocksSSE, 16};
+#endif // BASE64_SIMD_X86
+        return result;
+    }();
+    return decoder;
+}
 
-        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-        char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+Base64StreamDecoder::Base64StreamDecoder(bool accept_urlsafe) : m_urlsafe(accept_urlsafe) {}
 
-        for (string_size j = 0; (j < i - 1); j++)
-            ret += char_array_3[j];
+void Base64StreamDecoder::feed(const char *data, size_t size, std::string &out)
+{
+    const Base64DecodeTables &tables = decodeTables();
+    const Base64SimdDecoder &simd = simdDecoder();
+    // the scalar loop takes over up to the first character that is not base64
+    size_t simd_from = 0;
+    for (size_t k = 0; k < size && !m_ended; k++)
+    {
+        if (m_count == 0 && simd.decode && k >= simd_from && size - k >= simd.block_size)
+        {
+            size_t invalid_at = size - k;
+            size_t start = k;
+            k += simd.decode(data + k, size - k, m_urlsafe, out, invalid_at);
+            simd_from = start + invalid_at + 1;
+            if (k == size)
+                break;
+        }
+        unsigned char uchar = data[k];
+        if (uchar == '=')
+        {
+            m_ended = true;
+            break;
+        }
+        if (!(m_urlsafe ? tables.is_base64[uchar] : (tables.is_base64[uchar] == 1)))
+        {
+            out += static_cast<char>(uchar); // not base64 encoded data, copy to result
+            m_count = 0;
+            continue;
+        }
+        m_group[m_count++] = uchar;
+        if (m_count == 4)
+        {
+            decodeGroup(m_group, 4, out);
+            m_count = 0;
+        }
     }
+}
 
+void Base64StreamDecoder::finish(std::string &out)
+{
+    if (m_count)
+        decodeGroup(m_group, m_count, out);
+    m_count = 0;
+    m_ended = true;
+}
+
+std::string base64Decode(const std::string &encoded_string, bool accept_urlsafe)
+{
+    std::string ret;
+    ret.reserve(encoded_string.size() / 4 * 3 + 3);
+    Base64StreamDecoder decoder(accept_urlsafe);
+    decoder.feed(encoded_string.data(), encoded_string.size(), ret);
+    decoder.finish(ret);
     return ret;
 }
 
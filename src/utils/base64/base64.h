@@ -6,6 +6,33 @@
 std::string base64Decode(const std::string &encoded_string, bool accept_urlsafe = false);
 std::string base64Encode(const std::string &string_to_encode);
 
+/// encodes like base64Encode() with input that arrives in pieces, appending to the output as it goes
+class Base64StreamEncoder
+{
+public:
+    void feed(const char *data, size_t size, std::string &out);
+    void finish(std::string &out);
+
+private:
+    unsigned char m_group[3] = {};
+    size_t m_count = 0;
+};
+
+/// decodes like base64Decode() with input that arrives in pieces, decoding stops at the first '='
+class Base64StreamDecoder
+{
+public:
+    explicit Base64StreamDecoder(bool accept_urlsafe = false);
+    void feed(const char *data, size_t size, std::string &out);
+    void finish(std::string &out);
+
+private:
+    bool m_urlsafe = false;
+    bool m_ended = false;
+    unsigned char m_group[4] = {};
+    size_t m_count = 0;
+};
+
 std::string urlSafeBase64Apply(const std::string &encoded_string);
 std::string urlSafeBase64Reverse(const std::string &encoded_string);
 std::string urlSafeBase64Decode(const std::string &encoded_string);
@@ -2,6 +2,10 @@
 #define LOCK_H_INCLUDED
 
 #include <atomic>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
 #include <thread>
 
 class RWLock
@@ -76,4 +80,104 @@ public:
     }
 };
 
+/// the stripe a key falls in, shared by every structure that is split by key so that one key always maps to the same slot
+inline size_t keyStripe(const std::string &key, size_t stripeCount)
+{
+    return std::hash<std::string>{}(key) % stripeCount;
+}
+
+/// std::shared_mutex that counts how often it was taken and how often that had to wait,
+/// usable with std::unique_lock and std::shared_lock
+class CountingSharedMutex
+{
+private:
+    std::shared_mutex m_lock;
+    std::atomic<size_t> m_acquired {0}, m_contended {0};
+public:
+    void lock()
+    {
+        m_acquired++;
+        if(!m_lock.try_lock())
+        {
+            m_contended++;
+            m_lock.lock();
+        }
+    }
+    bool try_lock() { return m_lock.try_lock(); }
+    void unlock() { m_lock.unlock(); }
+    void lock_shared()
+    {
+        m_acquired++;
+        if(!m_lock.try_lock_shared())
+        {
+            m_contended++;
+            m_lock.lock_shared();
+        }
+    }
+    bool try_lock_shared() { return m_lock.try_lock_shared(); }
+    void unlock_shared() { m_lock.unlock_shared(); }
+    size_t acquired() const { return m_acquired; }
+    size_t contended() const { return m_contended; }
+};
+
+/// reader/writer locks spread over a fixed set of stripes chosen by key hash,
+/// waiting threads are put to sleep by the OS instead of spinning
+class StripedRWLock
+{
+private:
+    const size_t m_stripe_count;
+    std::unique_ptr<std::shared_mutex[]> m_stripes;
+    std::atomic<size_t> m_acquired {0}, m_contended {0};
+
+    std::shared_mutex &stripe(const std::string &key)
+    {
+        return m_stripes[keyStripe(key, m_stripe_count)];
+    }
+public:
+    StripedRWLock(const StripedRWLock&) = delete;
+    StripedRWLock& operator=(const StripedRWLock&) = delete;
+    explicit StripedRWLock(size_t stripeCount = 64): m_stripe_count(stripeCount), m_stripes(new std::shared_mutex[stripeCount]) {}
+    void readLock(const std::string &key)
+    {
+        std::shared_mutex &lock = stripe(key);
+        m_acquired++;
+        if(!lock.try_lock_shared())
+        {
+            m_contended++;
+            lock.lock_shared();
+        }
+    }
+    void readUnlock(const std::string &key)
+    {
+        stripe(key).unlock_shared();
+    }
+    void writeLock(const std::string &key)
+    {
+        std::shared_mutex &lock = stripe(key);
+        m_acquired++;
+        if(!lock.try_lock())
+        {
+            m_contended++;
+            lock.lock();
+        }
+    }
+    void writeUnlock(const std::string &key)
+    {
+        stripe(key).unlock();
+    }
+    /// lock every stripe in a fixed order, for operations on the whole set of keys
+    void writeLockAll()
+    {
+        for(size_t i = 0; i < m_stripe_count; i++)
+            m_stripes[i].lock();
+    }
+    void writeUnlockAll()
+    {
+        for(size_t i = m_stripe_count; i > 0; i--)
+            m_stripes[i - 1].unlock();
+    }
+    size_t acquired() const { return m_acquired; }
+    size_t contended() const { return m_contended; }
+};
+
 #endif //LOCK_H_INCLUDED
@@ -1,5 +1,14 @@
 #include <string>
+#include <algorithm>
 #include <cstdarg>
+#include <atomic>
+#include <cctype>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 /*
 #ifdef USE_STD_REGEX
@@ -11,6 +20,7 @@ using jp = jpcre2::select<char>;
 //#endif // USE_STD_REGEX
 
 #include "regexp.h"
+#include "string.h"
 
 /*
 #ifdef USE_STD_REGEX
@@ -131,38 +141,304 @@ int regGetMatch(const std::string &src, const std::string &match, size_t group_c
 
 #else
 */
-bool regMatch(const std::string &src, const std::string &match)
+/// shape of a pattern that can be answered without running PCRE2
+enum class RegexShape
+{
+    Pattern,
+    Contains,
+    Prefix,
+    Suffix,
+    Exact
+};
+
+struct CompiledRegex
 {
     jp::Regex reg;
-    reg.setPattern(match).addModifier("m").addPcre2Option(PCRE2_ANCHORED|PCRE2_ENDANCHORED|PCRE2_UTF).compile();
-    if(!reg)
+    uint32_t capture_count = 0;
+    RegexShape shape = RegexShape::Pattern;
+    std::string literal;
+    bool caseless = false;
+};
+
+namespace
+{
+    char asciiLower(char c)
+    {
+        return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+    }
+
+    /// recognize plain literals, optionally anchored with ^ and/or $, escaped punctuation is allowed.
+    /// a leading (?i) is accepted for ASCII literals, which are then compared ignoring ASCII case
+    RegexShape classifyPattern(const std::string &pattern, std::string &literal, bool &caseless)
+    {
+        static const std::string_view meta = "\\^$.|?*+()[]{";
+        std::string_view body = pattern;
+        bool anchor_begin = false, anchor_end = false;
+        if(body.starts_with("(?i)"))
+        {
+            caseless = true;
+            body.remove_prefix(4);
+        }
+        if(!body.empty() && body.front() == '^')
+        {
+            anchor_begin = true;
+            body.remove_prefix(1);
+        }
+        if(!body.empty() && body.back() == '$' && (body.size() < 2 || body[body.size() - 2] != '\\'))
+        {
+            anchor_end = true;
+            body.remove_suffix(1);
+        }
+        literal.clear();
+        for(size_t i = 0; i < body.size(); i++)
+        {
+            char c = body[i];
+            if(c == '\\')
+            {
+                if(i + 1 == body.size() || !ispunct(static_cast<unsigned char>(body[i + 1])))
+                    return RegexShape::Pattern;
+                literal += body[++i];
+                continue;
+            }
+            if(meta.find(c) != std::string_view::npos || (caseless && static_cast<unsigned char>(c) >= 0x80))
+                return RegexShape::Pattern;
+            literal += caseless ? asciiLower(c) : c;
+        }
+        if(anchor_begin && anchor_end)
+            return RegexShape::Exact;
+        if(anchor_begin)
+            return RegexShape::Prefix;
+        if(anchor_end)
+            return RegexShape::Suffix;
+        return RegexShape::Contains;
+    }
+
+    /// process-wide LRU of compiled patterns, keyed by pattern plus compile flags
+    class RegexCache
+    {
+        using entry_list = std::list<std::pair<std::string, RegexHandle>>;
+    private:
+        std::mutex m_lock;
+        entry_list m_entries;
+        std::unordered_map<std::string, entry_list::iterator> m_index;
+        size_t m_capacity = 4096;
+        std::atomic_size_t m_hits {0}, m_misses {0}, m_evictions {0};
+
+        void trim()
+        {
+            while(m_entries.size() > m_capacity)
+            {
+                m_index.erase(m_entries.back().first);
+                m_entries.pop_back();
+                ++m_evictions;
+            }
+        }
+    public:
+        RegexHandle get(const std::string &pattern, const char *modifier, uint32_t options)
+        {
+            std::string key = std::to_string(options);
+            key += modifier;
+            key += ':';
+            key += pattern;
+            {
+                std::lock_guard<std::mutex> guard(m_lock);
+                auto iter = m_index.find(key);
+                if(iter != m_index.end())
+                {
+                    m_entries.splice(m_entries.begin(), m_entries, iter->second);
+                    ++m_hits;
+                    return iter->second->second;
+                }
+            }
+            ++m_misses;
+
+            /// compile outside the lock, invalid patterns are cached as well so they fail fast next time
+            auto entry = std::make_shared<CompiledRegex>();
+            entry->reg.setPattern(pattern).addModifier(modifier).addPcre2Option(options).addJpcre2Option(jpcre2::JIT_COMPILE).compile();
+            if(entry->reg)
+            {
+                pcre2_pattern_info_8(entry->reg.getPcre2Code(), PCRE2_INFO_CAPTURECOUNT, &entry->capture_count);
+                entry->caseless = options & PCRE2_CASELESS;
+                entry->shape = classifyPattern(pattern, entry->literal, entry->caseless);
+            }
+
+            std::lock_guard<std::mutex> guard(m_lock);
+            auto iter = m_index.find(key);
+            if(iter != m_index.end()) // another thread compiled the same pattern meanwhile
+                return iter->second->second;
+            m_entries.emplace_front(key, entry);
+            m_index.emplace(std::move(key), m_entries.begin());
+            trim();
+            return entry;
+        }
+
+        void setCapacity(size_t capacity)
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_capacity = capacity ? capacity : 1;
+            trim();
+        }
+
+        RegexCacheStats stats()
+        {
+            RegexCacheStats result;
+            result.hits = m_hits;
+            result.misses = m_misses;
+            result.evictions = m_evictions;
+            std::lock_guard<std::mutex> guard(m_lock);
+            result.entries = m_entries.size();
+            return result;
+        }
+    };
+
+    RegexCache &regexCache()
+    {
+        static RegexCache cache;
+        return cache;
+    }
+
+    /// per-thread match data blocks, one per ovector size since jpcre2 reports every ovector pair as a group
+    jp::MatchData *threadMatchData(const CompiledRegex &entry)
+    {
+        struct MatchDataDeleter
+        {
+            void operator()(jp::MatchData *data) const { pcre2_match_data_free_8(data); }
+        };
+        thread_local std::vector<std::unique_ptr<jp::MatchData, MatchDataDeleter>> blocks;
+        uint32_t pairs = entry.capture_count + 1;
+        if(blocks.size() <= pairs)
+            blocks.resize(pairs + 1);
+        if(!blocks[pairs])
+            blocks[pairs].reset(pcre2_match_data_create_8(pairs, nullptr));
+        return blocks[pairs].get();
+    }
+
+    /// caseless literals are stored in lowercase
+    bool caselessEqual(std::string_view text, std::string_view literal)
+    {
+        if(text.size() != literal.size())
+            return false;
+        for(size_t i = 0; i < text.size(); i++)
+        {
+            if(asciiLower(text[i]) != literal[i])
+                return false;
+        }
+        return true;
+    }
+
+    bool caselessContains(std::string_view subject, std::string_view literal)
+    {
+        if(literal.empty())
+            return true;
+        for(size_t i = 0; i + literal.size() <= subject.size(); i++)
+        {
+            if(asciiLower(subject[i]) == literal[0] && caselessEqual(subject.substr(i, literal.size()), literal))
+                return true;
+        }
         return false;
-    return reg.match(src, "g");
+    }
+
+    bool literalMatch(const CompiledRegex &entry, const std::string &src, bool full, int &result)
+    {
+        std::string_view subject = src, literal = entry.literal;
+        /// in UTF mode k and s also match the Kelvin sign and the long s, leave non-ASCII subjects to PCRE2 for those
+        if(entry.caseless && literal.find_first_of("KkSs") != std::string_view::npos &&
+           std::any_of(subject.begin(), subject.end(), [](char c){ return static_cast<unsigned char>(c) >= 0x80; }))
+            return false;
+        auto equal = [&](std::string_view part){ return entry.caseless ? caselessEqual(part, literal) : part == literal; };
+        if(full) // anchored at both ends, anchors in the pattern are redundant
+        {
+            result = equal(subject);
+            return true;
+        }
+        if(entry.shape == RegexShape::Contains)
+        {
+            result = entry.caseless ? caselessContains(subject, literal) : subject.find(literal) != std::string_view::npos;
+            return true;
+        }
+        /// ^ and $ also match around line breaks in multiline mode, leave those subjects to PCRE2
+        if(subject.find('\n') != std::string_view::npos || subject.find('\r') != std::string_view::npos)
+            return false;
+        switch(entry.shape)
+        {
+        case RegexShape::Prefix:
+            result = subject.size() >= literal.size() && equal(subject.substr(0, literal.size()));
+            break;
+        case RegexShape::Suffix:
+            result = subject.size() >= literal.size() && equal(subject.substr(subject.size() - literal.size()));
+            break;
+        default:
+            result = equal(subject);
+            break;
+        }
+        return true;
+    }
+
+    bool cachedMatch(const CompiledRegex &entry, const std::string &src, bool full = false)
+    {
+        int result = 0;
+        if(entry.shape != RegexShape::Pattern && literalMatch(entry, src, full, result))
+            return result;
+        jp::RegexMatch rm(&entry.reg);
+        return rm.setSubject(src).setMatchDataBlock(threadMatchData(entry)).match();
+    }
 }
 
-bool regFind(const std::string &src, const std::string &match)
+RegexHandle regCompile(const std::string &pattern)
 {
-    jp::Regex reg;
-    reg.setPattern(match).addModifier("m").addPcre2Option(PCRE2_UTF|PCRE2_ALT_BSUX).compile();
-    if(!reg)
+    return regexCache().get(pattern, "m", PCRE2_UTF|PCRE2_ALT_BSUX);
+}
+
+bool regFind(const std::string &src, const RegexHandle &reg)
+{
+    if(!reg || !reg->reg)
+        return false;
+    return cachedMatch(*reg, src);
+}
+
+bool regMatch(const std::string &src, const std::string &match)
+{
+    auto entry = regexCache().get(match, "m", PCRE2_ANCHORED|PCRE2_ENDANCHORED|PCRE2_UTF);
+    if(!entry->reg)
         return false;
-    return reg.match(src, "g");
+    return cachedMatch(*entry, src, true);
+}
+
+bool regFind(const std::string &src, const std::string &match)
+{
+    return regFind(src, regCompile(match));
 }
 
 std::string regReplace(const std::string &src, const std::string &match, const std::string &rep, bool global, bool multiline)
 {
-    jp::Regex reg;
-    reg.setPattern(match).addModifier(multiline ? "m" : "").addPcre2Option(PCRE2_UTF|PCRE2_MULTILINE|PCRE2_ALT_BSUX).compile();
-    if(!reg)
+    auto entry = regexCache().get(match, multiline ? "m" : "", PCRE2_UTF|PCRE2_MULTILINE|PCRE2_ALT_BSUX);
+    if(!entry->reg)
         return src;
-    return reg.replace(src, rep, global ? "gEx" : "Ex");
+    if(entry->shape == RegexShape::Contains && !entry->caseless && !entry->literal.empty() && rep.find_first_of("$\\") == std::string::npos)
+    {
+        std::string result;
+        string_size last = 0, pos = src.find(entry->literal);
+        if(pos == std::string::npos)
+            return src;
+        while(pos != std::string::npos)
+        {
+            result.append(src, last, pos - last);
+            result += rep;
+            last = pos + entry->literal.size();
+            if(!global)
+                break;
+            pos = src.find(entry->literal, last);
+        }
+        result.append(src, last);
+        return result;
+    }
+    jp::RegexReplace rr(&entry->reg);
+    return rr.setSubject(src).setReplaceWith(rep).setModifier(global ? "gEx" : "Ex").setMatchDataBlock(threadMatchData(*entry)).replace();
 }
 
 bool regValid(const std::string &reg)
 {
-    jp::Regex r;
-    r.setPattern(reg).addPcre2Option(PCRE2_UTF|PCRE2_ALT_BSUX).compile();
-    return !!r;
+    return !!regexCache().get(reg, "", PCRE2_UTF|PCRE2_ALT_BSUX)->reg;
 }
 
 int regGetMatch(const std::string &src, const std::string &match, size_t group_count, ...)
@@ -189,12 +465,13 @@ int regGetMatch(const std::string &src, const std::string &match, size_t group_c
 
 std::vector<std::string> regGetAllMatch(const std::string &src, const std::string &match, bool group_only)
 {
-    jp::Regex reg;
-    reg.setPattern(match).addModifier("m").addPcre2Option(PCRE2_UTF|PCRE2_ALT_BSUX).compile();
-    jp::VecNum vec_num;
-    jp::RegexMatch rm;
-    size_t count = rm.setRegexObject(&reg).setSubject(src).setNumberedSubstringVector(&vec_num).setModifier("gm").match();
     std::vector<std::string> result;
+    auto entry = regexCache().get(match, "m", PCRE2_UTF|PCRE2_ALT_BSUX);
+    if(!entry->reg)
+        return result;
+    jp::VecNum vec_num;
+    jp::RegexMatch rm(&entry->reg);
+    size_t count = rm.setSubject(src).setNumberedSubstringVector(&vec_num).setModifier("gm").setMatchDataBlock(threadMatchData(*entry)).match();
     if(!count)
         return result;
     size_t begin = 0;
@@ -217,6 +494,71 @@ std::vector<std::string> regGetAllMatch(const std::string &src, const std::strin
     return result;
 }
 
+bool regCanCombine(const std::string &pattern)
+{
+    /// back references, named groups, recursion, callouts and verbs depend on the pattern's own group numbering or position,
+    /// \K moves the reported start of a match, and an extended-mode comment would swallow the rest of the combined pattern
+    static const std::string unsafe = R"(\\[1-9gkKQ]|\(\?(?:P?<[A-Za-z_]|P[=>]|'|&|R|C|[0-9+\-])|\(\*|\(\?\^?[A-Za-z]*(?:-[A-Za-z]*)?x)";
+    return regValid(pattern) && !regFind(pattern, unsafe);
+}
+
+std::string regCombine(const std::vector<std::string> &patterns)
+{
+    /// one alternation, each alternative leaves a mark with its index once it matched
+    std::string result;
+    for(size_t i = 0; i < patterns.size(); i++)
+    {
+        if(i)
+            result += "|";
+        result += "(?:" + patterns[i] + ")(*MARK:" + std::to_string(i) + ")";
+    }
+    return result;
+}
+
+int regFindAny(const std::string &src, const std::string &combined)
+{
+    std::string prefix;
+    const std::string *pattern = &combined;
+    int found = -1;
+    PCRE2_SIZE start = 0;
+    /// the leftmost match is not always the first pattern in the list. the patterns before it failed at its position,
+    /// so only they are tried again and only further along. the alternatives never contain verbs, so the text up to
+    /// a mark is itself the alternation of the patterns before it, and each of these prefixes is compiled only once
+    while(start <= src.size())
+    {
+        auto entry = regexCache().get(*pattern, "m", PCRE2_UTF|PCRE2_ALT_BSUX);
+        if(!entry->reg)
+            break;
+        jp::MatchData *match_data = threadMatchData(*entry);
+        int rc = pcre2_match_8(entry->reg.getPcre2Code(), reinterpret_cast<PCRE2_SPTR8>(src.data()), src.size(), start, 0, match_data, nullptr);
+        if(rc < 0)
+            break;
+        PCRE2_SPTR8 mark = pcre2_get_mark_8(match_data);
+        if(mark == nullptr)
+            break;
+        found = to_int(reinterpret_cast<const char*>(mark), -1);
+        if(found <= 0)
+            break;
+        std::string previous = "(*MARK:" + std::to_string(found - 1) + ")";
+        prefix.assign(*pattern, 0, pattern->find(previous) + previous.size());
+        pattern = &prefix;
+        start = pcre2_get_ovector_pointer_8(match_data)[0] + 1;
+        while(start < src.size() && (static_cast<unsigned char>(src[start]) & 0xC0) == 0x80)
+            start++;
+    }
+    return found;
+}
+
+RegexCacheStats regCacheStats()
+{
+    return regexCache().stats();
+}
+
+void regCacheSetCapacity(size_t capacity)
+{
+    regexCache().setCapacity(capacity);
+}
+
 //#endif // USE_STD_REGEX
 
 std::string regTrim(const std::string &src)
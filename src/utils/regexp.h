@@ -1,14 +1,34 @@
 #ifndef REGEXP_H_INCLUDED
 #define REGEXP_H_INCLUDED
 
+#include <memory>
 #include <string>
+#include <vector>
+
+struct RegexCacheStats
+{
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t entries = 0;
+};
+
+struct CompiledRegex;
+using RegexHandle = std::shared_ptr<const CompiledRegex>;
 
 bool regValid(const std::string &reg);
 bool regFind(const std::string &src, const std::string &match);
+bool regFind(const std::string &src, const RegexHandle &reg);
+RegexHandle regCompile(const std::string &pattern);
 std::string regReplace(const std::string &src, const std::string &match, const std::string &rep, bool global = true, bool multiline = true);
 bool regMatch(const std::string &src, const std::string &match);
 int regGetMatch(const std::string &src, const std::string &match, size_t group_count, ...);
 std::vector<std::string> regGetAllMatch(const std::string &src, const std::string &match, bool group_only = false);
 std::string regTrim(const std::string &src);
+bool regCanCombine(const std::string &pattern);
+std::string regCombine(const std::vector<std::string> &patterns);
+int regFindAny(const std::string &src, const std::string &combined);
+RegexCacheStats regCacheStats();
+void regCacheSetCapacity(size_t capacity);
 
 #endif // REGEXP_H_INCLUDED
@@ -0,0 +1,64 @@
+#ifndef SINGLEFLIGHT_H_INCLUDED
+#define SINGLEFLIGHT_H_INCLUDED
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// runs at most one call per key at a time, concurrent callers with the same key wait for and share its result
+template <typename T>
+class SingleFlight
+{
+public:
+    template <typename Fn>
+    T run(const std::string &key, Fn &&fn)
+    {
+        std::promise<T> promise;
+        std::shared_future<T> future;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            auto iter = m_calls.find(key);
+            if(iter != m_calls.end())
+                future = iter->second;
+            else
+                m_calls.emplace(key, promise.get_future().share());
+        }
+        if(future.valid())
+        {
+            m_shared++;
+            return future.get();
+        }
+        m_executed++;
+        try
+        {
+            T result = fn();
+            promise.set_value(result);
+            forget(key);
+            return result;
+        }
+        catch(...)
+        {
+            promise.set_exception(std::current_exception());
+            forget(key);
+            throw;
+        }
+    }
+
+    size_t executed() const { return m_executed; }
+    size_t shared() const { return m_shared; }
+
+private:
+    void forget(const std::string &key)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_calls.erase(key);
+    }
+
+    std::mutex m_lock;
+    std::unordered_map<std::string, std::shared_future<T>> m_calls;
+    std::atomic<size_t> m_executed {0}, m_shared {0};
+};
+
+#endif // SINGLEFLIGHT_H_INCLUDED
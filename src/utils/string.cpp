@@ -211,6 +211,23 @@ std::string trimOf(const std::string& str, char target, bool before, bool after)
     return str.substr(pos);
 }
 
+std::string_view trimOf(std::string_view str, char target, bool before, bool after)
+{
+    if (!before && !after)
+        return str;
+    string_size pos = 0;
+    if (before)
+        pos = str.find_first_not_of(target);
+    if (pos == std::string_view::npos)
+        return str;
+    string_size pos2 = str.size() - 1;
+    if (after)
+        pos2 = str.find_last_not_of(target);
+    if (pos2 != std::string_view::npos)
+        return str.substr(pos, pos2 - pos + 1);
+    return str.substr(pos);
+}
+
 std::string trim(const std::string& str, bool before, bool after)
 {
     return trimOf(str, ' ', before, after);
@@ -240,6 +257,25 @@ std::string trimWhitespace(const std::string &str, bool before, bool after)
     return str.substr(bpos, epos - bpos + 1);
 }
 
+std::string_view trimWhitespace(std::string_view str, bool before, bool after)
+{
+    constexpr std::string_view whitespaces(" \t\f\v\n\r");
+    string_size bpos = 0, epos = str.size();
+    if(after)
+    {
+        epos = str.find_last_not_of(whitespaces);
+        if(epos == std::string_view::npos)
+            return {};
+    }
+    if(before)
+    {
+        bpos = str.find_first_not_of(whitespaces);
+        if(bpos == std::string_view::npos)
+            return {};
+    }
+    return str.substr(bpos, epos - bpos + 1);
+}
+
 std::string getUrlArg(const std::string &url, const std::string &request)
 {
     //std::smatch result;
@@ -38,6 +38,8 @@ std::string trim(const std::string& str, bool before = true, bool after = true);
 std::string trimQuote(const std::string &str, bool before = true, bool after = true);
 void trimSelfOf(std::string &str, char target, bool before = true, bool after = true);
 std::string trimWhitespace(const std::string &str, bool before = false, bool after = true);
+std::string_view trimOf(std::string_view str, char target, bool before = true, bool after = true);
+std::string_view trimWhitespace(std::string_view str, bool before = false, bool after = true);
 std::string randomStr(int len);
 bool isStrUTF8(const std::string &data);
 
@@ -99,6 +101,51 @@ inline char getLineBreak(const std::string &str)
     return count_least(str, '\n', 1) ? '\n' : '\r';
 }
 
+/// walks the pieces of a text separated by a delimiter without copying, giving the same pieces as getline()
+class StringTokenizer
+{
+public:
+    StringTokenizer(std::string_view text, char delimiter) : m_text(text), m_delimiter(delimiter) {}
+
+    bool next(std::string_view &token)
+    {
+        if(m_pos >= m_text.size())
+            return false;
+        string_size end = m_text.find(m_delimiter, m_pos);
+        if(end == std::string_view::npos)
+            end = m_text.size();
+        token = m_text.substr(m_pos, end - m_pos);
+        m_pos = end + 1;
+        return true;
+    }
+
+    char delimiter() const { return m_delimiter; }
+
+private:
+    std::string_view m_text;
+    char m_delimiter;
+    string_size m_pos = 0;
+};
+
+/// lines of a text, split by '\n' when there is one and by '\r' otherwise, the '\r' of "\r\n" endings is dropped
+class LineTokenizer
+{
+public:
+    explicit LineTokenizer(std::string_view text) : m_tokenizer(text, text.find('\n') != std::string_view::npos ? '\n' : '\r') {}
+
+    bool next(std::string_view &line)
+    {
+        if(!m_tokenizer.next(line))
+            return false;
+        if(m_tokenizer.delimiter() == '\n' && !line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        return true;
+    }
+
+private:
+    StringTokenizer m_tokenizer;
+};
+
 template <typename T>
 concept Arithmetic = std::is_arithmetic_v<T>;
 
@@ -0,0 +1,89 @@
+#ifndef STRING_POOL_H_INCLUDED
+#define STRING_POOL_H_INCLUDED
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// gives the distinct values of a low-cardinality field dense ids, so that work depending only on the value is done once per value.
+/// values are not copied, they have to outlive the pool
+class StringPool
+{
+public:
+    uint32_t intern(std::string_view value)
+    {
+        auto iter = m_ids.find(value);
+        if(iter != m_ids.end())
+            return iter->second;
+        uint32_t id = m_values.size();
+        m_ids.emplace(value, id);
+        m_values.push_back(value);
+        return id;
+    }
+
+private:
+    std::unordered_map<std::string_view, uint32_t> m_ids;
+    std::vector<std::string_view> m_values;
+};
+
+/// an immutable string stored once and shared by every holder of the same value, for node fields that repeat across a whole subscription.
+/// values are deduplicated through a bounded pool per thread, so equal values from one parse share storage and compare by pointer
+class InternedString
+{
+public:
+    InternedString() = default;
+    InternedString(const std::string &value) : m_value(intern(value)) {}
+    InternedString(const char *value) : m_value(intern(value)) {}
+
+    const std::string &str() const { return m_value ? *m_value : emptyValue(); }
+    operator const std::string&() const { return str(); }
+    bool empty() const { return !m_value; }
+    size_t size() const { return str().size(); }
+    const char *c_str() const { return str().c_str(); }
+    const char *data() const { return str().data(); }
+
+    friend bool operator==(const InternedString &a, const InternedString &b) { return a.m_value == b.m_value || a.str() == b.str(); }
+    friend bool operator==(const InternedString &a, const std::string &b) { return a.str() == b; }
+    friend bool operator==(const InternedString &a, const char *b) { return a.str() == b; }
+
+    friend std::string operator+(const InternedString &a, const InternedString &b) { return a.str() + b.str(); }
+    friend std::string operator+(const InternedString &a, const std::string &b) { return a.str() + b; }
+    friend std::string operator+(const std::string &a, const InternedString &b) { return a + b.str(); }
+    friend std::string operator+(const InternedString &a, const char *b) { return a.str() + b; }
+    friend std::string operator+(const char *a, const InternedString &b) { return a + b.str(); }
+
+private:
+    using Handle = std::shared_ptr<const std::string>;
+
+    static const std::string &emptyValue()
+    {
+        static const std::string value;
+        return value;
+    }
+
+    static Handle intern(std::string_view value)
+    {
+        /// values come from untrusted subscriptions, the pool is dropped when full and nodes keep what they hold
+        static constexpr size_t max_pool_size = 4096;
+        thread_local std::unordered_map<std::string_view, Handle> pool;
+        if(value.empty())
+            return nullptr;
+        auto iter = pool.find(value);
+        if(iter != pool.end())
+            return iter->second;
+        if(pool.size() >= max_pool_size)
+            pool.clear();
+        Handle handle = std::make_shared<const std::string>(value);
+        pool.emplace(*handle, handle);
+        return handle;
+    }
+
+    Handle m_value;
+};
+
+using InternedArray = std::vector<InternedString>;
+
+#endif // STRING_POOL_H_INCLUDED
@@ -5,6 +5,28 @@
 #include <string>
 #include <vector>
 
+#include "utils/string_pool.h"
+
+namespace YAML
+{
+    template<>
+    struct convert<InternedString>
+    {
+        static Node encode(const InternedString &rhs)
+        {
+            return Node(rhs.str());
+        }
+
+        static bool decode(const Node &node, InternedString &rhs)
+        {
+            if(!node.IsScalar())
+                return false;
+            rhs = node.Scalar();
+            return true;
+        }
+    };
+}
+
 template <typename T> void operator >> (const YAML::Node& node, T& i)
 {
     if(node.IsDefined() && !node.IsNull()) //fail-safe